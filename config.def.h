@@ -36,10 +36,40 @@ static const unsigned int borderpx  = 1;        /* border pixel of windows */
  *      moving or resizing a window using the mouse
  */
 static const unsigned int snap      = 32;       /* snap pixel */
+/* With focus follows mouse the window under the mouse cursor is focused as soon as the cursor
+ * enters it. Setting this to a number of milliseconds delays that until the mouse cursor has
+ * rested on the window for that long, so that moving the mouse across several windows does not
+ * focus each of them in turn. Clicking on a window always focuses it immediately. */
+static const unsigned int hoverdelay = 0;       /* 0 means focus immediately */
+/* Windows that are moved or resized using the mouse are updated at the refresh rate of the monitor
+ * the mouse cursor is on. This is the refresh rate that is assumed if it can't be determined, e.g.
+ * when dwm is compiled without RandR support (see config.mk). */
+static const unsigned int refreshrate = 60;     /* refresh rate (Hz) */
+/* Clients that support the _NET_WM_SYNC_REQUEST protocol are instead resized as fast as they can
+ * keep up with. This is how long to wait for such a client to catch up with the previous size
+ * before sending it the next one regardless. */
+static const unsigned int syncrequesttimeout = 100; /* milliseconds */
 /* Whether the bar is shown by default on startup or not. */
 static const int showbar            = 1;        /* 0 means no bar */
+/* Whether the bar only shows the tags that are occupied by clients or that are being viewed. This
+ * is useful with many tags, where showing all of them would take up the whole bar. */
+static const int hidevacant         = 0;        /* 1 means hide vacant tags */
 /* Whether the bar is shown at the top or at the bottom of the monitor. */
 static const int topbar             = 1;        /* 0 means bottom bar */
+/* The minimum time in milliseconds between redraws of the status text. Status monitors that
+ * update the root window name many times per second would otherwise make dwm redraw the bar just
+ * as often. The latest status is always shown once the time has passed. */
+static const unsigned int statusthrottle = 50;  /* 0 means redraw on every update */
+/* Tags that are not viewed are laid out in the background once dwm has been idle for this many
+ * milliseconds, so that viewing a tag does not have to wait for its clients to be resized. */
+static const unsigned int prearrangedelay = 200; /* 0 means only lay out viewed tags */
+/* Connecting, disconnecting or reconfiguring monitors makes the X server send a burst of events.
+ * The monitors are updated, and the clients arranged, once no such events have come in for this
+ * many milliseconds. */
+static const unsigned int geomdelay = 100;      /* 0 means update on every event */
+/* How often, in milliseconds, the statistics are written to $XDG_RUNTIME_DIR/dwm-<display>.prom.
+ * This only applies if dwm is compiled with statistics, see config.mk. */
+static const unsigned int statsinterval = 15000; /* 0 means no statistics file */
 /* This defines the primary font and optionally fallback fonts. If a glyph does not exist for a
  * character (code point) in the primary font then fallback fonts will be checked.
  * If the fallback fonts also do not have that character then system fonts will be checked for the
@@ -112,13 +142,14 @@ static const char *colors[][3]      = {
 };
 
 /* These define the tag icons (or text) used in the bar while the number of strings in the array
- * determine the number of tags being used by dwm. This has an upper limit of 32 tags and anything
- * above that will result in a compilation error. */
+ * determine the number of tags being used by dwm. This has an upper limit of MAXTAGS tags, as set
+ * in config.mk, and anything above that will result in a compilation error. */
 static const char *tags[] = { "1", "2", "3", "4", "5", "6", "7", "8", "9" };
 
 /* This array controls the client rules which consists of three rule matching filters (the class,
- * instance and title) and three rule options (tags, whether the client is floating or not and the
- * monitor it is supposed to start on).
+ * instance and title) and four rule options (tags, whether the client is floating or not, the
+ * monitor it is supposed to start on and whether moving and resizing the client with the mouse
+ * should only draw a wireframe outline until the mouse button is released).
  *
  * Refer to the writeup of the applyrules function for more details on this.
  */
@@ -127,9 +158,9 @@ static const Rule rules[] = {
 	 *	WM_CLASS(STRING) = instance, class
 	 *	WM_NAME(STRING) = title
 	 */
-	/* class      instance    title       tags mask     isfloating   monitor */
-	{ "Gimp",     NULL,       NULL,       0,            1,           -1 },
-	{ "Firefox",  NULL,       NULL,       1 << 8,       0,           -1 },
+	/* class      instance    title       tags mask     isfloating   monitor   wireframe */
+	{ "Gimp",     NULL,       NULL,       TAGNONE,      1,           -1,       0 },
+	{ "Firefox",  NULL,       NULL,       TAGBIT(8),    0,           -1,       0 },
 };
 
 /* layout(s) */
@@ -157,13 +188,17 @@ static const int lockfullscreen = 1; /* 1 will force focus on the fullscreen win
  * layout function may make changes to the layout symbol, for example the monocle layout that shows
  * the number of clients visible.
  *
+ * The max motion rate limits how many times per second a window is moved or resized while it is
+ * being dragged with the mouse when the layout is in use. By default this follows the refresh rate
+ * of the monitor, a lower value can help on slow (e.g. remote) displays. 0 means no limit.
+ *
  * Refer to the setlayout function writeup for more details.
  */
 static const Layout layouts[] = {
-	/* symbol     arrange function */
-	{ "[]=",      tile },    /* first entry is default */
-	{ "><>",      NULL },    /* no layout function means floating behavior */
-	{ "[M]",      monocle },
+	/* symbol     arrange function  max motion rate */
+	{ "[]=",      tile,             0 },    /* first entry is default */
+	{ "><>",      NULL,             0 },    /* no layout function means floating behavior */
+	{ "[M]",      monocle,          0 },
 };
 
 /* key definitions */
@@ -195,19 +230,22 @@ static const Layout layouts[] = {
  * In this case the KEY variable will be XK_3 and the TAG value will be 2. This would then
  * expand in the keys array to:
  *
- *    { MODKEY,                       XK_3,     view,           {.ui = 1 << 2} }, \
- *    { MODKEY|ControlMask,           XK_3,     toggleview,     {.ui = 1 << 2} }, \
- *    { MODKEY|ShiftMask,             XK_3,     tag,            {.ui = 1 << 2} }, \
- *    { MODKEY|ControlMask|ShiftMask, XK_3,     toggletag,      {.ui = 1 << 2} },
+ *    { MODKEY,                       XK_3,     view,           {.v = TAGSET(2)} }, \
+ *    { MODKEY|ControlMask,           XK_3,     toggleview,     {.v = TAGSET(2)} }, \
+ *    { MODKEY|ShiftMask,             XK_3,     tag,            {.v = TAGSET(2)} }, \
+ *    { MODKEY|ControlMask|ShiftMask, XK_3,     toggletag,      {.v = TAGSET(2)} },
+ *
+ * The TAGSET macro gives a pointer to a set of tags that holds only the given tag, refer to the
+ * Tagset type in dwm.c.
  *
  * Using a macro also makes it easier to change the modifiers used for the functions
  * if need be.
  */
 #define TAGKEYS(KEY,TAG) \
-	{ MODKEY,                       KEY,      view,           {.ui = 1 << TAG} }, \
-	{ MODKEY|ControlMask,           KEY,      toggleview,     {.ui = 1 << TAG} }, \
-	{ MODKEY|ShiftMask,             KEY,      tag,            {.ui = 1 << TAG} }, \
-	{ MODKEY|ControlMask|ShiftMask, KEY,      toggletag,      {.ui = 1 << TAG} },
+	{ MODKEY,                       KEY,      view,           {.v = TAGSET(TAG)} }, \
+	{ MODKEY|ControlMask,           KEY,      toggleview,     {.v = TAGSET(TAG)} }, \
+	{ MODKEY|ShiftMask,             KEY,      tag,            {.v = TAGSET(TAG)} }, \
+	{ MODKEY|ControlMask|ShiftMask, KEY,      toggletag,      {.v = TAGSET(TAG)} },
 
 /* Helper for spawning shell commands in the pre dwm-5.0 fashion */
 #define SHCMD(cmd) { .v = (const char*[]){ "/bin/sh", "-c", cmd, NULL } }
@@ -254,8 +292,8 @@ static const Key keys[] = {
 	{ MODKEY,                       XK_m,      setlayout,      {.v = &layouts[2]} },
 	{ MODKEY,                       XK_space,  setlayout,      {0} },
 	{ MODKEY|ShiftMask,             XK_space,  togglefloating, {0} },
-	{ MODKEY,                       XK_0,      view,           {.ui = ~0 } },
-	{ MODKEY|ShiftMask,             XK_0,      tag,            {.ui = ~0 } },
+	{ MODKEY,                       XK_0,      view,           {.v = &tagmask } },
+	{ MODKEY|ShiftMask,             XK_0,      tag,            {.v = &tagmask } },
 	{ MODKEY,                       XK_comma,  focusmon,       {.i = -1 } },
 	{ MODKEY,                       XK_period, focusmon,       {.i = +1 } },
 	{ MODKEY|ShiftMask,             XK_comma,  tagmon,         {.i = -1 } },
@@ -272,6 +310,13 @@ static const Key keys[] = {
 	{ MODKEY|ShiftMask,             XK_q,      quit,           {0} },
 };
 
+/* Key bindings for the functions listed here accumulate while the key is held down. If the
+ * keyboard auto-repeat produces key presses faster than they can be handled then the queued up
+ * key presses are merged into a single call where the argument is multiplied by the number of key
+ * presses, e.g. three key presses of MOD+h become one call to setmfact with -0.15. Only functions
+ * that take a relative argument are suitable for this. */
+static void (*const accumulating[])(const Arg *) = { focusstack, incnmaster, setmfact };
+
 /* Mouse button definitions.
  * The buttons array contains user defined mouse button bindings and the functions that said
  * bindings should trigger. Refer to the grabbuttons function for details on how the window manager
@@ -305,6 +350,8 @@ static const Button buttons[] = {
 	{ ClkClientWin,         MODKEY,         Button1,        movemouse,      {0} },
 	{ ClkClientWin,         MODKEY,         Button2,        togglefloating, {0} },
 	{ ClkClientWin,         MODKEY,         Button3,        resizemouse,    {0} },
+	{ ClkClientWin,         MODKEY|ShiftMask, Button1,      movemouse,      {.i = 1} },
+	{ ClkClientWin,         MODKEY|ShiftMask, Button3,      resizemouse,    {.i = 1} },
 	{ ClkTagBar,            0,              Button1,        view,           {0} },
 	{ ClkTagBar,            0,              Button3,        toggleview,     {0} },
 	{ ClkTagBar,            MODKEY,         Button1,        tag,            {0} },
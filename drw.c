@@ -603,6 +603,9 @@ drw_text(Drw *drw, int x, int y, unsigned int w, unsigned int h, unsigned int lp
 	 * called before we have everything we need set up (like colour schemes, fonts, etc.). */
 	if (!drw || (render && (!drw->scheme || !w)) || !text || !drw->fonts)
 		return 0;
+	/* Only drawing is traced, measuring the width of text happens far too often. */
+	if (render)
+		TRACEBEGIN("drw_text");
 
 	/* If we are only calculating the width of the text then do not impose any limit on the width,
 	 * unless this is called from drw_fontset_getwidth_clamp which passes in a maximum width via
@@ -622,8 +625,10 @@ drw_text(Drw *drw, int x, int y, unsigned int w, unsigned int h, unsigned int lp
 		/* Cover for an edge case where the remaining width is less than the left padding in which
 		 * we just skip to the end. Without this it is possible to end up with an unsigned integer
 		 * underflow (i.e. w ending up very very large) and text potentially being overwritten. */
-		if (w < lpad)
+		if (w < lpad) {
+			TRACEEND();
 			return x + w;
+		}
 
 		/* We prepare the XftDraw structure that will be used to draw the text later. */
 		d = XftDrawCreate(drw->dpy, drw->drawable,
@@ -840,7 +845,9 @@ drw_text(Drw *drw, int x, int y, unsigned int w, unsigned int h, unsigned int lp
 			FcDefaultSubstitute(fcpattern);
 
 			/* The matching font, if any. */
+			TRACEBEGIN("XftFontMatch");
 			match = XftFontMatch(drw->dpy, drw->screen, fcpattern, &result);
+			TRACEEND();
 
 			/* Cleanup, free the character set and fontconfig pattern. */
 			FcCharSetDestroy(fccharset);
@@ -880,6 +887,8 @@ no_match:
 
 	/* Finally we return the x position following the drawn text, or just x in the event that we
 	 * are only after the text width. The w here represents the remaining space. */
+	if (render)
+		TRACEEND();
 	return x + (render ? w : 0);
 }
 
@@ -903,7 +912,9 @@ drw_map(Drw *drw, Window win, int x, int y, unsigned int w, unsigned int h)
 	XCopyArea(drw->dpy, drw->drawable, win, drw->gc, x, y, w, h, x, y);
 	/* This flushes the output buffer and then waits until all requests have been
 	 * received and processed by the X server. */
+	TRACEBEGIN("XSync");
 	XSync(drw->dpy, False);
+	TRACEEND();
 }
 
 /* This copies graphics from the drawable and places that on the designated window.
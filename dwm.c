@@ -236,7 +236,6 @@
  *    │  │  │  ├── updatewmhints
  *    │  │  │  ├── updatesizehints
  *    │  │  │  ├── grabbuttons
- *    │  │  │  │  └── updatenumlockmask
  *    │  │  │  ├── unfocus
  *    │  │  │  ├── setclientstate
  *    │  │  │  ├── updatetitle
@@ -416,9 +415,6 @@
  *    │  │  │  ├── wintoclient
  *    │  │  │  └── recttomon
  *    │  │  └── drawbar
- *    │  ├── motionnotify
- *    │  │  ├── recttomon
- *    │  │  └── focus
  *    │  ├── scan
  *    │  │  └── manage
  *    │  │     └── ecalloc
@@ -451,24 +447,36 @@
  * unfocus.
  */
 #include <errno.h>
+#include <limits.h>
 #include <locale.h>
+#include <poll.h>
 #include <signal.h>
 #include <stdarg.h>
+#include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <time.h>
 #include <unistd.h>
+#include <sys/epoll.h>
+#include <sys/signalfd.h>
+#include <sys/timerfd.h>
 #include <sys/types.h>
 #include <sys/wait.h>
 #include <X11/cursorfont.h>
 #include <X11/keysym.h>
+#include <X11/XKBlib.h>
 #include <X11/Xatom.h>
 #include <X11/Xlib.h>
 #include <X11/Xproto.h>
 #include <X11/Xutil.h>
+#include <X11/extensions/sync.h>
 #ifdef XINERAMA
 #include <X11/extensions/Xinerama.h>
 #endif /* XINERAMA */
+#ifdef XRANDR
+#include <X11/extensions/Xrandr.h>
+#endif /* XRANDR */
 #include <X11/Xft/Xft.h>
 
 #include "drw.h"
@@ -488,9 +496,14 @@
  * See the writeup in the recttomon function for more information on this. */
 #define INTERSECT(x,y,w,h,m)    (MAX(0, MIN((x)+(w),(m)->wx+(m)->ww) - MAX((x),(m)->wx)) \
                                * MAX(0, MIN((y)+(h),(m)->wy+(m)->wh) - MAX((y),(m)->wy)))
+/* This macro returns true for event types that are the direct result of the user interacting
+ * with the keyboard or the mouse. The run function dispatches these ahead of other events (mostly
+ * notifications that originate from client windows) that have been read at the same time. */
+#define ISINPUT(T)              ((T) == KeyPress || (T) == KeyRelease || (T) == ButtonPress \
+                               || (T) == ButtonRelease || (T) == MotionNotify || (T) == EnterNotify)
 /* This macro returns true if any of the given client's tags is on any of the tags currently being
  * viewed on the monitor. */
-#define ISVISIBLE(C)            ((C->tags & C->mon->tagset[C->mon->seltags]))
+#define ISVISIBLE(C)            (tagsintersect(&(C)->tags, &(C)->mon->tagset[(C)->mon->seltags]))
 /* The MOUSEMASK macro is used in the movemouse and resizemouse user functions and it indicates
  * that we are interested in receiving events when the mouse cursor moves in addition to when the
  * button is released. */
@@ -499,23 +512,22 @@
 #define WIDTH(X)                ((X)->w + 2 * (X)->bw)
 /* The actual height of a client window includes the border and this macro helps calculate that. */
 #define HEIGHT(X)               ((X)->h + 2 * (X)->bw)
-/* The TAGMASK macro gives a binary value that represents a valid bitmask according to how many
- * tags are defined.
- *
- * As an example dwm by default comes with nine tags and the bitmask is a 32 bit integer. In this
- * case the TAGMASK macro would return a binary value like this:
- *
- *    00000000000000000000000111111111
- *
- * but if the configuration was changed so that there are icons defined for four tags then the
- * TAGMASK macro would return a binary value like this:
- *
- *    00000000000000000000000000001111
- *
- * The TAGMASK is used in various places to restrict and to validate bitmask values used in the
- * context of what tags are viewed by the monitor and what tags are assigned to a client.
- */
-#define TAGMASK                 ((1 << LENGTH(tags)) - 1)
+/* The maximum number of tags is set at compile time in config.mk. The tags are held in a Tagset,
+ * which is an array of 64 bit words, and TAGWORDS is the number of words needed for MAXTAGS tags.
+ * With the default of 64 tags a Tagset is a single word and the tag set operations below cost no
+ * more than the plain bitwise operations on an unsigned int that they replace. */
+#ifndef MAXTAGS
+#define MAXTAGS                 64
+#endif
+#define TAGWORDS                ((MAXTAGS + 63) / 64)
+/* The TAGBIT macro is an initialiser for a Tagset that holds the single given tag, where 0 is the
+ * first tag. It is used in the configuration file for the rules, e.g. TAGBIT(8) for tag 9, while
+ * TAGNONE is the initialiser for an empty Tagset, used for rules that do not set any tags. The
+ * TAGSET macro gives a pointer to such a Tagset that is used as an argument for the view,
+ * toggleview, tag and toggletag user functions in the configuration file. */
+#define TAGBIT(T)               { .w = { [(T) / 64] = (uint64_t)1 << ((T) % 64) } }
+#define TAGNONE                 { { 0 } }
+#define TAGSET(T)               (&(const Tagset)TAGBIT(T))
 /* The TEXTW macro returns the width of a given text string plus the left and right padding.
  *
  * Due to that not all fonts have every glyph and we have a primary font and fallback fonts this
@@ -539,7 +551,8 @@ enum { SchemeNorm, SchemeSel }; /* color schemes */
 /* This represents the various extended window manager hint atoms that dwm supports. */
 enum { NetSupported, NetWMName, NetWMState, NetWMCheck,
        NetWMFullscreen, NetActiveWindow, NetWMWindowType,
-       NetWMWindowTypeDialog, NetClientList, NetLast }; /* EWMH atoms */
+       NetWMWindowTypeDialog, NetClientList, NetWMSyncRequest,
+       NetWMSyncRequestCounter, NetLast }; /* EWMH atoms */
 /* This represents various window manager hint atoms that dwm supports. */
 enum { WMProtocols, WMDelete, WMState, WMTakeFocus, WMLast }; /* default atoms */
 /* This represents the various click options that can be used when defining mouse button press
@@ -556,16 +569,128 @@ enum { ClkTagBar, ClkLtSymbol, ClkStatusText, ClkWinTitle,
  * A union is conceptually similar to structures, with the difference being that of memory
  * allocation. In a structure each variable (also referred to as a member) has allocated space
  * whereas in a union all the variables share the same memory. The Arg type that are passed to
- * user functions is a union which means that the argument can be an integer, an unsigned integer,
- * a float value or a pointer, but the argument can only hold a single value.
+ * user functions is a union which means that the argument can be an integer, a float value or a
+ * pointer, but the argument can only hold a single value.
+ *
+ * There is deliberately no unsigned integer member. Tags used to be passed as a bit mask in such
+ * a member, e.g. {.ui = 1 << 8}, and a configuration that still does so should fail to compile
+ * rather than pass a mask where a pointer to a Tagset is expected. Use the TAGSET macro instead.
  */
 typedef union {
 	int i;
-	unsigned int ui;
 	float f;
 	const void *v;
 } Arg;
 
+/* A set of tags, where tag i is represented by bit i % 64 of word i / 64. This is used for the
+ * tags that a client is shown on as well as for the tags that a monitor views. Tagsets are passed
+ * to the view, toggleview, tag and toggletag user functions using the v member of the Arg union,
+ * see the TAGSET macro.
+ *
+ * The small functions below implement the set operations that dwm needs. With TAGWORDS being 1
+ * the loops go away entirely when compiled. */
+typedef struct {
+	uint64_t w[TAGWORDS];
+} Tagset;
+
+/* Sets d to the intersection of a and b. */
+static inline void
+tagsand(Tagset *d, const Tagset *a, const Tagset *b)
+{
+	int i;
+	for (i = 0; i < TAGWORDS; i++)
+		d->w[i] = a->w[i] & b->w[i];
+}
+
+/* Removes tag t from the set. */
+static inline void
+tagsclear(Tagset *s, unsigned int t)
+{
+	s->w[t / 64] &= ~((uint64_t)1 << (t % 64));
+}
+
+/* Returns 1 if the set holds no tags. */
+static inline int
+tagsempty(const Tagset *s)
+{
+	int i;
+	for (i = 0; i < TAGWORDS; i++)
+		if (s->w[i])
+			return 0;
+	return 1;
+}
+
+/* Returns 1 if the two sets hold the same tags. */
+static inline int
+tagsequal(const Tagset *a, const Tagset *b)
+{
+	int i;
+	for (i = 0; i < TAGWORDS; i++)
+		if (a->w[i] != b->w[i])
+			return 0;
+	return 1;
+}
+
+/* Returns 1 if the two sets have at least one tag in common. */
+static inline int
+tagsintersect(const Tagset *a, const Tagset *b)
+{
+	int i;
+	for (i = 0; i < TAGWORDS; i++)
+		if (a->w[i] & b->w[i])
+			return 1;
+	return 0;
+}
+
+/* Sets d to the union of a and b. */
+static inline void
+tagsor(Tagset *d, const Tagset *a, const Tagset *b)
+{
+	int i;
+	for (i = 0; i < TAGWORDS; i++)
+		d->w[i] = a->w[i] | b->w[i];
+}
+
+/* Adds tag t to the set. */
+static inline void
+tagsset(Tagset *s, unsigned int t)
+{
+	s->w[t / 64] |= (uint64_t)1 << (t % 64);
+}
+
+/* Returns 1 + the index of the tag if the set holds exactly one tag, 0 otherwise. */
+static inline unsigned int
+tagssingle(const Tagset *s)
+{
+	unsigned int i, t = 0;
+	uint64_t w;
+
+	for (i = 0; i < TAGWORDS; i++) {
+		if (!(w = s->w[i]))
+			continue;
+		if (t || w & (w - 1))
+			return 0;
+		for (t = i * 64 + 1; !(w & 1); w >>= 1, t++);
+	}
+	return t;
+}
+
+/* Returns 1 if the set holds tag t. */
+static inline int
+tagstest(const Tagset *s, unsigned int t)
+{
+	return (s->w[t / 64] >> (t % 64)) & 1;
+}
+
+/* Sets d to the tags that are in either a or b, but not in both. */
+static inline void
+tagsxor(Tagset *d, const Tagset *a, const Tagset *b)
+{
+	int i;
+	for (i = 0; i < TAGWORDS; i++)
+		d->w[i] = a->w[i] ^ b->w[i];
+}
+
 /* The definition of a button, used in the configuration file when setting up mouse button
  * bindings.
  *
@@ -584,42 +709,48 @@ typedef struct {
 	const Arg arg;
 } Button;
 
+/* A region of the bar as laid out by the drawbar function, used by the buttonpress function to
+ * work out what the user clicked on. The x variable holds the position where the region ends
+ * (exclusive), the region starts where the previous region ends. The argument holds the tag
+ * bitmask for tags and the segment index for status text segments. */
+typedef struct {
+	int x;
+	unsigned int click;
+	Arg arg;
+} BarRegion;
+
 /* Here we are declaring that we are going to have a struct called Monitor without going into
  * details of what exactly this struct looks like. This is because the Client struct refers to
  * the current monitor, while the monitor is going to have a list of clients. We define these
  * structs alphabetically thus the Client is defined before the Monitor. */
 typedef struct Monitor Monitor;
 typedef struct Client Client;
+typedef struct ClientCold ClientCold;
 
-/* The Client struct represents a window that is managed by the window manager. */
+/* The Client struct represents a window that is managed by the window manager.
+ *
+ * The fields that are used when laying out, stacking and focusing clients are kept here, ordered
+ * roughly by how often they are used, while fields that are rarely used are kept in a separate
+ * ClientCold struct. That way the fields that layouts go through for every client share as few
+ * cache lines as possible, rather than being spread out around the 256 byte window title.
+ * Clients are allocated from a pool, refer to the manage function. */
 struct Client {
-	/* The name holds the window title. */
-	char name[256];
-	/* The mina and maxa represents the minimum and maximum aspect ratios as per size hints. */
-	float mina, maxa;
+	/* The next and previous client in the client list, which is a doubly linked list. The
+	 * client list controls the order in which clients are tiled. The previous link allows a
+	 * client to be removed from the list without searching for it, refer to detach. */
+	Client *next, *prev;
+	/* The next and previous client in the stacking order list, which is also a doubly linked
+	 * list. The stacking order indicates which window is on top of others as well as the order
+	 * in which clients had focus. */
+	Client *snext, *sprev;
+	/* The monitor this client belongs to. */
+	Monitor *mon;
+	/* The managed window that this client represents. */
+	Window win;
 	/* The client x, y coordinates and size (width, height). */
 	int x, y, w, h;
-	/* These variables represent the client's previous size and position and they are maintained
-	 * in the resizeclient function. In practice in a stock dwm they are only used when a
-	 * fullscreen window exits fullscreen. */
-	int oldx, oldy, oldw, oldh;
-	/* These variables are all in relation to size hints.
-	 *    basew - base width
-	 *    baseh - base height
-	 *    incw - width increment
-	 *    inch - height increment
-	 *    minw - minimum width
-	 *    minh - minimum height
-	 *    maxw - maximum width
-	 *    maxh - maximum height
-	 *    hintsvalid - flag indicating whether size hints need to be refreshed
-	 */
-	int basew, baseh, incw, inch, maxw, maxh, minw, minh, hintsvalid;
-	/* Border width (bw) and old border width. The old border width is set in the manage
-	 * function and is used in the unmanage function in the event that the window was not
-	 * destroyed. The setfullscreen function also relies on this variable. See comment in the
-	 * unmanage function. */
-	int bw, oldbw;
+	/* The border width. */
+	int bw;
 	/* This represents the tags the client is shown on. This is a bitmask where each bit
 	 * represents whether the client is shown on that tag.
 	 *
@@ -628,9 +759,10 @@ struct Client {
 	 *    001010001  - bitmask
 	 *    987654321  - tags
 	 *
-	 * This would mean that the client is shown on tags 1, 5 and 7.
+	 * This would mean that the client is shown on tags 1, 5 and 7. Refer to the Tagset type for
+	 * how bitmasks for more than 64 tags are represented.
 	 */
-	unsigned int tags;
+	Tagset tags;
 	/* Various status flags.
 	 *    isfixed      - means that the client is fixed in size due to minimum and maximum size
 	 *                   hints being the same value
@@ -641,25 +773,83 @@ struct Client {
 	 *                   neverfocus indicates that the client should never receive input focus
 	 *                   as indicated by the window manager hints for the window
 	 *                   (see updatewmhints and setfocus functions)
-	 *    oldstate     - represents the previous state in the event that the client goes into
-	 *                   fullscreen, the variable is only used to indicate whether the client
-	 *                   was floating or not
 	 *    isfullscreen - indicates whether the window is in fullscreen
 	 */
-	int isfixed, isfloating, isurgent, neverfocus, oldstate, isfullscreen;
-	/* The next client in the client list, which is a linked list. The client list controls the
-	 * order in which clients are tiled. */
-	Client *next;
-	/* The next client in the stacking order list, which is also a linked list. The stacking
-	 * order indicates which window is on top of others as well as the order in which clients
-	 * had focus. */
-	Client *snext;
-	/* The monitor this client belongs to. */
-	Monitor *mon;
-	/* The managed window that this client represents. */
-	Window win;
+	int isfixed, isfloating, isurgent, neverfocus, isfullscreen;
+	/* The mina and maxa represents the minimum and maximum aspect ratios as per size hints. */
+	float mina, maxa;
+	/* These variables are all in relation to size hints.
+	 *    basew - base width
+	 *    baseh - base height
+	 *    incw - width increment
+	 *    inch - height increment
+	 *    minw - minimum width
+	 *    minh - minimum height
+	 *    maxw - maximum width
+	 *    maxh - maximum height
+	 *    hintsvalid - flag indicating whether size hints need to be refreshed
+	 */
+	int basew, baseh, incw, inch, maxw, maxh, minw, minh, hintsvalid;
+	/* The focus state and the grabgen value at the time the button grabs were made for the
+	 * client window, refer to the grabbuttons function. */
+	int grabfocused;
+	unsigned int grabgen;
+	/* The fields that are rarely used, refer to the ClientCold struct. */
+	ClientCold *cold;
+};
+
+/* The ClientCold struct holds the fields of a client that are rarely used, refer to the Client
+ * struct. It is allocated along with the client and freed along with it. */
+struct ClientCold {
+	/* The name holds the window title. */
+	char name[256];
+	/* These variables represent the client's previous size and position. They are set in the manage
+	 * function and saved by the setfullscreen and configurerequest functions, and they are only
+	 * used when a fullscreen window exits fullscreen. */
+	int oldx, oldy, oldw, oldh;
+	/* The old border width is set in the manage function and is used in the unmanage function
+	 * in the event that the window was not destroyed. The setfullscreen function also relies on
+	 * this variable. See comment in the unmanage function. */
+	int oldbw;
+	/* This represents the previous state in the event that the client goes into fullscreen, the
+	 * variable is only used to indicate whether the client was floating or not. */
+	int oldstate;
+	/* Whether moving and resizing the client with the mouse should only draw an outline of the
+	 * new geometry rather than resize the client window continuously, as per client rules.
+	 * Refer to the movemouse function. */
+	int wireframe;
+	/* The XSync counter that the client updates when it has finished redrawing after having been
+	 * resized, and the value that the counter is expected to reach. The counter is None if the
+	 * client does not support the _NET_WM_SYNC_REQUEST protocol. Refer to the resizemouse
+	 * function. */
+	XSyncCounter synccounter;
+	XSyncValue syncvalue;
+	/* The name of the RandR monitor that the client was on before that monitor went away, or
+	 * None. The client is moved back to that monitor when it comes back, refer to the
+	 * updategeom function. */
+	Atom rrhome;
 };
 
+#ifdef STATS
+/* A histogram in the spirit of HDR histograms, used for the statistics. Values below HISTSUB have a
+ * bucket each and every power of two above that is split into HISTSUB buckets of equal width,
+ * which keeps the relative error below 1 / HISTSUB regardless of the magnitude of the value. With
+ * nanoseconds the last bucket holds everything above four seconds or so. Refer to the histadd
+ * function.
+ *    count   - the number of values recorded
+ *    sum     - the sum of the values recorded
+ *    max     - the largest value recorded
+ *    buckets - the number of values recorded in each bucket
+ */
+#define HISTBITS                2
+#define HISTSUB                 (1 << HISTBITS)
+#define HISTLEN                 128
+typedef struct {
+	unsigned long count, sum, max;
+	unsigned long buckets[HISTLEN];
+} Hist;
+#endif /* STATS */
+
 /* The definition of a key, used in the configuration file when setting up key bindings.
  *
  * static Key keys[] = {
@@ -676,20 +866,59 @@ typedef struct {
 	const Arg arg;
 } Key;
 
+/* A slot in the key table that the grabkeys function compiles from the keys array, refer to the
+ * keypress function for how it is used. A slot that has no key is empty. */
+typedef struct {
+	unsigned int keycode;
+	unsigned int mod;
+	const Key *key;
+} KeySlot;
+
+/* A key code and its top level keysym, used by the grabkeys function when populating the key
+ * table. */
+typedef struct {
+	KeySym keysym;
+	unsigned int keycode;
+} KeySymCode;
+
 /* The definition of a layout, used in the configuration file when setting up layouts.
  *
  * static const Layout layouts[] = {
- * 	// symbol     arrange function
- * 	{ "[]=",      tile },    // first entry is default
- * 	{ "><>",      NULL },    // no layout function means floating behavior
- * 	{ "[M]",      monocle },
+ * 	// symbol     arrange function  max motion rate
+ * 	{ "[]=",      tile,             0 },    // first entry is default
+ * 	{ "><>",      NULL,             0 },    // no layout function means floating behavior
+ * 	{ "[M]",      monocle,          0 },
  * };
+ *
+ * The max motion rate limits how many times per second a window is moved or resized while it is
+ * being dragged with the mouse, refer to the dragevent function. 0 means no limit other than
+ * the refresh rate of the monitor.
  */
 typedef struct {
 	const char *symbol;
 	void (*arrange)(Monitor *);
+	unsigned int maxrate;
 } Layout;
 
+/* The layout state that is kept for each tag, refer to the pertag variable of the Monitor struct.
+ *    nmaster - the number of clients in the master area
+ *    mfact   - the master / stack factor
+ *    sellt   - the selected layout, either 0 or 1
+ *    lt      - the previous and current layout
+ *    showbar - whether the bar is shown
+ *    sel     - the client that last had focus while viewing the tag
+ *    gen     - the generation of the monitor when the tag was last laid out while hidden
+ */
+typedef struct {
+	int nmaster;
+	float mfact;
+	unsigned int sellt;
+	const Layout *lt[2];
+	int showbar;
+	Client *sel;
+	unsigned long gen;
+} Pertag;
+
 /* This represents individual monitors (screens) if Xinerama is used, or a single monitor
  * representing the entire screen space if Xinerama is not enabled. */
 struct Monitor {
@@ -768,7 +997,7 @@ struct Monitor {
 	unsigned int sellt;
 	/* This array holds the previously and currently viewed tags for the monitor, the index of
 	 * which is indicated by the seltags variable. */
-	unsigned int tagset[2];
+	Tagset tagset[2];
 	/* Internal flag indicating whether the bar is shown or not. */
 	int showbar;
 	/* Internal flag indicating whether the bar is shown at the top or at the bottom. */
@@ -776,6 +1005,21 @@ struct Monitor {
 	/* The client list. This represents the start of a linked list of clients which determines
 	 * the order in which clients are tiled. */
 	Client *clients;
+	/* The visible clients and the visible tiled clients in the order of the client list. These
+	 * arrays let layouts and focusstack go through the clients they need without scanning the
+	 * clients that are on other tags. The arrays are rebuilt by the updatevisible function when
+	 * visvalid is 0, which is the case when clients are added to or removed from the client
+	 * list, or when the tags or the floating state of a client or the tagset of the monitor
+	 * change. The viscap variable holds the number of clients that the arrays have room for. */
+	Client **vis, **tiled;
+	int nvis, ntiled, viscap, visvalid;
+	/* The number of clients on each tag and the number of urgent clients on each tag, as well as
+	 * the bitmasks of tags that are occupied by clients and tags that have urgent clients. These
+	 * are kept up to date by the counttags function as clients come and go and as their tags and
+	 * urgency change, so that drawing the bar does not have to go through all clients. The
+	 * arrays hold one entry for each tag. */
+	unsigned int nocc[MAXTAGS], nurg[MAXTAGS];
+	Tagset occ, urg;
 	/* This represents the monitor's selected client. */
 	Client *sel;
 	/* The stacking order list. This represents the order in which client windows are stacked on
@@ -784,13 +1028,46 @@ struct Monitor {
 	/* Monitors are also managed as a linked list with the mons variable referring to the first
 	 * monitor. The next variable on the monitor refers to the next monitor in the list. */
 	Monitor *next;
+	/* The refresh rate of the monitor in Hz, used to pace window moves and resizes done with
+	 * the mouse. Refer to the updaterefresh and dragevent functions. */
+	unsigned int refresh;
 	/* This is the bar window which is used to draw the bar. Each monitor has their own bar. */
 	Window barwin;
+	/* This is an invisible (input only) window that covers the monitor and that sits below all
+	 * other windows. It is used to detect that the mouse cursor enters the monitor, refer to
+	 * the updatebars function. */
+	Window deskwin;
 	/* This array holds the previous and current layout for the monitor, the index of which is
 	 * indicated by the sellt variable. */
 	const Layout *lt[2];
+	/* The regions of the bar as laid out when the bar was last drawn, ordered from left to
+	 * right. Refer to the drawbar and buttonpress functions. */
+	BarRegion *regions;
+	int nregions;
+	/* The layout state for each tag. The first entry is used when viewing more than one tag
+	 * while entry 1 + i is used when viewing tag i only, the index of which is held by the
+	 * curtag variable. The mfact, nmaster, sellt, lt and showbar variables of the monitor hold
+	 * the state of the current entry, and functions that change them also update the entry.
+	 * Refer to the pertagview function. */
+	Pertag *pertag;
+	unsigned int curtag;
+	/* This is incremented every time that the monitor is arranged, which tells the tags that
+	 * are not viewed that they may need to be laid out again. Refer to prearrangetimeout. */
+	unsigned long gen;
+	/* The name of the RandR monitor (output) that this monitor represents, or None if the
+	 * monitors are not set up using RandR. Refer to the updategeom function. */
+	Atom rrname;
 };
 
+/* A slot in the window table, which maps the windows that dwm knows about to the client or the
+ * monitor that they belong to. Client windows have a client while the bar and desktop windows of
+ * a monitor have a monitor. A slot that has no window is empty. Refer to the winslot function. */
+typedef struct {
+	Window win;
+	Client *client;
+	Monitor *mon;
+} WinSlot;
+
 /* The definition of a rule, used in the configuration file when setting up client rules.
  *
  * static const Rule rules[] = {
@@ -798,9 +1075,9 @@ struct Monitor {
  *    //    WM_CLASS(STRING) = instance, class
  *    //    WM_NAME(STRING) = title
  *    //
- *    // class      instance    title       tags mask     isfloating   monitor
- *    { "Gimp",     NULL,       NULL,       0,            1,           -1 },
- *    { "Firefox",  NULL,       NULL,       1 << 8,       0,           -1 },
+ *    // class      instance    title       tags mask     isfloating   monitor   wireframe
+ *    { "Gimp",     NULL,       NULL,       TAGNONE,      1,           -1,       0 },
+ *    { "Firefox",  NULL,       NULL,       TAGBIT(8),    0,           -1,       0 },
  * };
  *
  * See the applyrules function for how the rules are applied.
@@ -809,14 +1086,29 @@ typedef struct {
 	const char *class;
 	const char *instance;
 	const char *title;
-	unsigned int tags;
+	Tagset tags;
 	int isfloating;
 	int monitor;
+	int wireframe;
 } Rule;
 
+/* This represents a file descriptor that the event loop in the run function waits on in addition
+ * to the X connection. When the file descriptor becomes readable the given function is called.
+ *    fd      - the file descriptor
+ *    istimer - whether the file descriptor is a timer, see addtimer
+ *    func    - the function to call when the file descriptor is readable, can be NULL
+ */
+typedef struct {
+	int fd;
+	int istimer;
+	void (*func)(void);
+} Source;
+
 /* Function declarations. All functions are declared for visibility and overview reasons. The
  * declarations as well as the functions themselves are sorted alphabetically so that they should
  * be easier to find and maintain. */
+static void addsource(int fd, int istimer, void (*func)(void));
+static int addtimer(void (*func)(void));
 static void applyrules(Client *c);
 static int applysizehints(Client *c, int *x, int *y, int *w, int *h, int interact);
 static void arrange(Monitor *m);
@@ -831,36 +1123,60 @@ static void clientmessage(XEvent *e);
 static void configure(Client *c);
 static void configurenotify(XEvent *e);
 static void configurerequest(XEvent *e);
+static void counttags(Client *c, int inc);
+static XSyncAlarm createalarm(Client *c);
 static Monitor *createmon(void);
 static void destroynotify(XEvent *e);
 static void detach(Client *c);
 static void detachstack(Client *c);
 static Monitor *dirtomon(int dir);
+static int dragevent(XEvent *ev, int throttle, long deadline);
 static void drawbar(Monitor *m);
 static void drawbars(void);
+static void drawoutline(Client *c, int x, int y, int w, int h);
 static void enternotify(XEvent *e);
 static void expose(XEvent *e);
 static void focus(Client *c);
 static void focusin(XEvent *e);
 static void focusmon(const Arg *arg);
 static void focusstack(const Arg *arg);
+static void geomtimeout(void);
 static Atom getatomprop(Client *c, Atom prop);
+static int getattributes(Window w, XWindowAttributes *wa);
 static int getrootptr(int *x, int *y);
 static long getstate(Window w);
 static int gettextprop(Window w, Atom atom, char *text, unsigned int size);
+static int gettransient(Window w, Window *trans);
 static void grabbuttons(Client *c, int focused);
 static void grabkeys(void);
+static int grabpointer(int cur);
+#ifdef STATS
+static void histadd(Hist *h, unsigned long v);
+static void histwrite(FILE *f, const char *name, const char *labels, const Hist *h, double scale);
+#endif /* STATS */
+static void hoverfocus(Window w);
+static void hovertimeout(void);
 static void incnmaster(const Arg *arg);
+static Bool isdragevent(Display *dpy, XEvent *ev, XPointer arg);
+static Bool ismotionhead(Display *dpy, XEvent *ev, XPointer arg);
+static unsigned int keyhash(unsigned int keycode, unsigned int mod);
 static void keypress(XEvent *e);
+static int keysymcodecmp(const void *a, const void *b);
 static void killclient(const Arg *arg);
 static void manage(Window w, XWindowAttributes *wa);
 static void mappingnotify(XEvent *e);
 static void maprequest(XEvent *e);
 static void monocle(Monitor *m);
-static void motionnotify(XEvent *e);
 static void movemouse(const Arg *arg);
+#ifdef XRANDR
+static void movetomon(Client *c, Monitor *m);
+#endif /* XRANDR */
 static Client *nexttiled(Client *c);
+static long nowms(void);
+static void pertagview(Monitor *m);
 static void pop(Client *c);
+static void prearrange(Monitor *m, unsigned int t);
+static void prearrangetimeout(void);
 static void propertynotify(XEvent *e);
 static void quit(const Arg *arg);
 static Monitor *recttomon(int x, int y, int w, int h);
@@ -868,6 +1184,9 @@ static void resize(Client *c, int x, int y, int w, int h, int interact);
 static void resizeclient(Client *c, int x, int y, int w, int h);
 static void resizemouse(const Arg *arg);
 static void restack(Monitor *m);
+#ifdef XRANDR
+static void rrnotify(XEvent *e);
+#endif /* XRANDR */
 static void run(void);
 static void scan(void);
 static int sendevent(Client *c, Atom proto);
@@ -877,10 +1196,19 @@ static void setfocus(Client *c);
 static void setfullscreen(Client *c, int fullscreen);
 static void setlayout(const Arg *arg);
 static void setmfact(const Arg *arg);
+static void settimer(int fd, unsigned int ms);
 static void setup(void);
 static void seturgent(Client *c, int urg);
 static void showhide(Client *c);
+static void sigevent(void);
 static void spawn(const Arg *arg);
+#ifdef STATS
+static unsigned long statsnow(void);
+static void statstimeout(void);
+static void statswrite(FILE *f);
+#endif /* STATS */
+static void statustimeout(void);
+static int syncresize(Client *c, XSyncAlarm alarm, int w, int h, Time time);
 static void tag(const Arg *arg);
 static void tagmon(const Arg *arg);
 static void tile(Monitor *m);
@@ -890,18 +1218,32 @@ static void toggletag(const Arg *arg);
 static void toggleview(const Arg *arg);
 static void unfocus(Client *c, int setfocus);
 static void unmanage(Client *c, int destroyed);
+static void unmanageall(void);
 static void unmapnotify(XEvent *e);
 static void updatebarpos(Monitor *m);
 static void updatebars(void);
 static void updateclientlist(void);
 static int updategeom(void);
+static void updatemontab(void);
 static void updatenumlockmask(void);
+#ifdef XRANDR
+static void updaterefresh(void);
+#endif /* XRANDR */
 static void updatesizehints(Client *c);
+#ifdef STATS
+static void updatestats(void);
+#endif /* STATS */
 static void updatestatus(void);
+static void updatesynccounter(Client *c);
 static void updatetitle(Client *c);
+static void updatevisible(Monitor *m);
 static void updatewindowtype(Client *c);
 static void updatewmhints(Client *c);
 static void view(const Arg *arg);
+static void winadd(Window w, Client *c, Monitor *m);
+static void windel(Window w);
+static unsigned int winhash(Window w);
+static WinSlot *winslot(Window w);
 static Client *wintoclient(Window w);
 static Monitor *wintomon(Window w);
 static int xerror(Display *dpy, XErrorEvent *ee);
@@ -938,6 +1280,14 @@ static int (*xerrorxlib)(Display *, XErrorEvent *);
  * press combinations.
  */
 static unsigned int numlockmask = 0;
+/* This is incremented whenever the numlockmask changes, which tells the grabbuttons function that
+ * the button grabs of client windows need to be redone. This starts at 1 so that new clients
+ * (that have a grabgen of 0) always get their buttons grabbed. */
+static unsigned int grabgen = 1;
+/* The key table that maps key codes and modifiers to key bindings, and the number of slots in the
+ * table (always a power of two). Refer to the grabkeys and keypress functions. */
+static KeySlot *keytab = NULL;
+static unsigned int keytabsize = 0;
 
 /* This is what maps event types to the functions that handles those event types.
  *
@@ -957,10 +1307,98 @@ static void (*handler[LASTEvent]) (XEvent *) = {
 	[KeyPress] = keypress,
 	[MappingNotify] = mappingnotify,
 	[MapRequest] = maprequest,
-	[MotionNotify] = motionnotify,
 	[PropertyNotify] = propertynotify,
 	[UnmapNotify] = unmapnotify
 };
+#if defined(STATS) || defined(TRACE)
+/* The names of the event types, used to label the statistics and the trace. The extra slot is for
+ * extension events (e.g. RandR) as these are not in the handler array. */
+static const char *evnames[LASTEvent + 1] = {
+	[KeyPress] = "KeyPress", [KeyRelease] = "KeyRelease",
+	[ButtonPress] = "ButtonPress", [ButtonRelease] = "ButtonRelease",
+	[MotionNotify] = "MotionNotify", [EnterNotify] = "EnterNotify",
+	[LeaveNotify] = "LeaveNotify", [FocusIn] = "FocusIn", [FocusOut] = "FocusOut",
+	[KeymapNotify] = "KeymapNotify", [Expose] = "Expose",
+	[GraphicsExpose] = "GraphicsExpose", [NoExpose] = "NoExpose",
+	[VisibilityNotify] = "VisibilityNotify", [CreateNotify] = "CreateNotify",
+	[DestroyNotify] = "DestroyNotify", [UnmapNotify] = "UnmapNotify",
+	[MapNotify] = "MapNotify", [MapRequest] = "MapRequest",
+	[ReparentNotify] = "ReparentNotify", [ConfigureNotify] = "ConfigureNotify",
+	[ConfigureRequest] = "ConfigureRequest", [GravityNotify] = "GravityNotify",
+	[ResizeRequest] = "ResizeRequest", [CirculateNotify] = "CirculateNotify",
+	[CirculateRequest] = "CirculateRequest", [PropertyNotify] = "PropertyNotify",
+	[SelectionClear] = "SelectionClear", [SelectionRequest] = "SelectionRequest",
+	[SelectionNotify] = "SelectionNotify", [ColormapNotify] = "ColormapNotify",
+	[ClientMessage] = "ClientMessage", [MappingNotify] = "MappingNotify",
+	[GenericEvent] = "GenericEvent", [LASTEvent] = "Extension",
+};
+#endif /* STATS || TRACE */
+/* The local event queue used by the run function. All events that are available at the time are
+ * read into this queue in one go so that user input can be dispatched ahead of the notifications
+ * that client windows may have flooded the X event queue with. The evqlen variable holds the
+ * number of events in the queue, events that have already been dispatched (or dropped) have their
+ * type set to 0. */
+static XEvent evq[256];
+static int evqlen = 0;
+#ifdef STATS
+/* Input latency statistics, refer to the run function. The time is when the events in the local
+ * event queue were read and the latency is measured from that point until the handler for an input
+ * event has finished executing, i.e. the time it takes from reading e.g. a KeyPress event until
+ * the resulting action has been carried out. The statistics are printed on exit. */
+static struct {
+	unsigned long time;
+	Hist hist;
+} inputlat;
+/* The number of events read into the local event queue in one go, refer to the run function. */
+static Hist queuedepth;
+/* The timer that periodically writes the statistics to the statistics file, the path of that
+ * file, and the atom of the root window property that holds the statistics on request. Refer to
+ * the statstimeout and updatestats functions. */
+static int statstimer = -1;
+static char statspath[PATH_MAX];
+static Atom statsatom;
+#endif /* STATS */
+/* The epoll instance used by the run function to wait for events, and the event sources that have
+ * been registered with it, refer to the addsource function. */
+static int epfd = -1;
+static Source sources[16];
+static int nsources = 0;
+/* The signal file descriptor through which we receive signals as events, see sigevent. */
+static int sigfd = -1;
+/* The timer that limits how often the status text is redrawn, see updatestatus. The statusbusy
+ * flag indicates that the timer is running and statuspending indicates that the status has been
+ * changed in the meantime. */
+static int statustimer = -1;
+static int statusbusy = 0, statuspending = 0;
+/* The timer that delays focus changes when the mouse cursor enters a window, and the window that
+ * the mouse cursor last entered. Refer to the enternotify function. */
+static int hovertimer = -1;
+static Window hoverwin = None;
+/* The timer that lays out tags that are not viewed once dwm has been idle for a while, and 1 +
+ * the index of the tag that is being laid out (0 when not). Refer to the prearrange function. */
+static int prearrangetimer = -1;
+static unsigned int prearranging = 0;
+/* EnterNotify events with a serial lower than this were generated by dwm changing the stacking
+ * order or window sizes and are ignored, refer to the restack function. */
+static unsigned long ignoreserial = 0;
+/* Whether the X server supports the XSync extension, as well as the event and error bases of the
+ * extension. Refer to the setup and resizemouse functions. */
+static int havesync = 0, syncevbase, syncerrbase = -1;
+/* The timer that delays updating the monitors until the events caused by a change to the monitor
+ * setup have settled, and whether the screen size has changed in the meantime. Refer to the
+ * configurenotify and geomtimeout functions. */
+static int geomtimer = -1, sizechanged = 0;
+/* The timer that paces window moves and resizes done with the mouse, whether a motion is being
+ * held back until the timer expires, that motion, and the time in milliseconds at which the
+ * previous motion was handled. Refer to the dragevent function. */
+static int dragtimer = -1, motionheld = 0;
+static XEvent heldmotion;
+static long motiontime = 0;
+#ifdef XRANDR
+/* Whether the X server supports RandR 1.5 monitors, in which case these are used to set up the
+ * monitors, and the event base of the extension. Refer to the updategeom function. */
+static int haverandr = 0, rrevbase;
+#endif /* XRANDR */
 /* This initialises the wmatom and netatom arrays which holds X atom references */
 static Atom wmatom[WMLast], netatom[NetLast];
 /* The global running variable indicates whether the window manager is running. When set to 0 then
@@ -978,35 +1416,133 @@ static Display *dpy;
 static Drw *drw;
 /* Two references to hold the first and the selected monitor. */
 static Monitor *mons, *selmon;
+/* The monitors are also held in the montab array, in the same order as in the linked list so that
+ * m->num is the index of monitor m in the array. This allows monitors to be looked up by number
+ * without going through the list. Refer to the updatemontab function. */
+static Monitor **montab = NULL;
+static int nmons = 0;
+/* A grid laid over the area covered by all monitors, used to look up what monitor a point is on.
+ * Each cell of the grid is gridw by gridh pixels and the top left cell starts at gridx, gridy. The
+ * monitors that overlap cell i are held in gridmons from index gridstart[i] up to, but not
+ * including, gridstart[i + 1]. Refer to the updatemontab and recttomon functions. */
+#define GRIDSIZE 16
+static int gridx, gridy, gridw = 1, gridh = 1;
+static unsigned int gridstart[GRIDSIZE * GRIDSIZE + 1];
+static Monitor **gridmons = NULL;
+/* The window table, refer to the winslot function. The size is always a power of two. */
+static WinSlot *wintab = NULL;
+static unsigned int wintabsize = 0, nwins = 0;
 /* Two window references, one for the root window and one for the supporting window. More on the
  * latter in the setup function. */
 static Window root, wmcheckwin;
+/* The tagmask holds all the tags that are defined in the configuration file, and tagbits holds a
+ * Tagset for each individual tag. The tagmask is used in various places to restrict and to validate
+ * tag sets used in the context of what tags are viewed by the monitor and what tags are assigned
+ * to a client. Both are set up by the setup function. */
+static Tagset tagmask, tagbits[MAXTAGS];
+/* The graphics context used to draw wireframe outlines on the root window, refer to the
+ * drawoutline function. */
+static GC wiregc;
+/* The pools that clients and monitors are allocated from, refer to the poolalloc function. */
+static Pool clientpool = { sizeof(Client), 64 };
+static Pool coldpool = { sizeof(ClientCold), 16 };
+static Pool monpool = { sizeof(Monitor), 4 };
 
 /* Configuration, allows nested code to access above variables */
 #include "config.h"
 
-/* Compile-time check if all tags fit into an unsigned int bit array. This causes a compilation
- * error if the user has added more than 31 entries in the tags array. This NumTags struct does
- * not actually cost anything because the compiler is free to discard it as it is not used by
+#ifdef STATS
+/* How long the event handlers and the functions bound to keys and buttons take, in nanoseconds.
+ * The extra event slot is for extension events (e.g. RandR) as these are not in the handler
+ * array. Refer to the run, keypress and buttonpress functions. */
+static Hist eventstats[LASTEvent + 1], keystats[LENGTH(keys)], buttonstats[LENGTH(buttons)];
+#endif /* STATS */
+
+/* Compile-time check if all tags fit into a Tagset. This causes a compilation error if the user
+ * has added more entries in the tags array than MAXTAGS, as set in config.mk. This NumTags struct
+ * does not actually cost anything because the compiler is free to discard it as it is not used by
  * anything. */
-struct NumTags { char limitexceeded[LENGTH(tags) > 31 ? -1 : 1]; };
+struct NumTags { char limitexceeded[LENGTH(tags) > MAXTAGS ? -1 : 1]; };
 
 /* Function implementations. Functions are ordered alphabetically and function names always
  * start on a new line to make them easier to find. */
 
+/* This registers a file descriptor as an event source with the event loop. When the file descriptor
+ * becomes readable then the given function is called from the run function. The function must
+ * consume whatever it was that made the file descriptor readable, otherwise it will be called
+ * again straight away. For timers this is handled by the run function.
+ *
+ * The X connection is registered without a function as X events are read separately.
+ *
+ * @called_from addtimer to register a timer
+ * @called_from setup to register the X connection and the signal file descriptor
+ * @calls epoll_ctl https://man7.org/linux/man-pages/man2/epoll_ctl.2.html
+ * @calls die if there are too many event sources or if the source could not be registered
+ *
+ * Internal call stack:
+ *    main -> setup -> addsource
+ */
+void
+addsource(int fd, int istimer, void (*func)(void))
+{
+	struct epoll_event ee = { .events = EPOLLIN };
+
+	if (nsources == LENGTH(sources))
+		die("dwm: too many event sources");
+
+	/* The index of the source is what is passed back to us when the file descriptor becomes
+	 * readable. */
+	ee.data.u32 = nsources;
+	if (epoll_ctl(epfd, EPOLL_CTL_ADD, fd, &ee) == -1)
+		die("epoll_ctl:");
+
+	sources[nsources].fd = fd;
+	sources[nsources].istimer = istimer;
+	sources[nsources].func = func;
+	nsources++;
+}
+
+/* This creates a new timer and registers it with the event loop. The timer is not running until
+ * it is started with settimer, after which the given function is called once when the timer
+ * expires.
+ *
+ * A timer that is not running does not cause the event loop to wake up, which means that when
+ * nothing happens dwm does not use any CPU.
+ *
+ * @called_from setup to create the timers used by dwm
+ * @calls timerfd_create https://man7.org/linux/man-pages/man2/timerfd_create.2.html
+ * @calls addsource to register the timer with the event loop
+ * @calls die if the timer could not be created
+ *
+ * Internal call stack:
+ *    main -> setup -> addtimer
+ */
+int
+addtimer(void (*func)(void))
+{
+	int fd;
+
+	if ((fd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK|TFD_CLOEXEC)) == -1)
+		die("timerfd_create:");
+	addsource(fd, 1, func);
+	return fd;
+}
+
 /* This function applies client rules for a client window.
  *
  * Example rules from the default configuration:
  *
  *    static const Rule rules[] = {
- *       // class      instance    title       tags mask     isfloating   monitor
- *       { "Gimp",     NULL,       NULL,       0,            1,           -1 },
- *       { "Firefox",  NULL,       NULL,       1 << 8,       0,           -1 },
+ *       // class      instance    title       tags mask     isfloating   monitor   wireframe
+ *       { "Gimp",     NULL,       NULL,       TAGNONE,      1,           -1,       0 },
+ *       { "Firefox",  NULL,       NULL,       TAGBIT(8),    0,           -1,       0 },
  *    };
  *
- * The first three fields are rule matching filters while the last three are rule options. What
+ * The first three fields are rule matching filters while the last four are rule options. What
  * this means is that a client window must match all of the class, instance and title filters in
- * order to get the tags mask, floating state and monitor options applied.
+ * order to get the tags mask, floating state, monitor and wireframe options applied. The
+ * wireframe option makes moving and resizing the client with the mouse only draw an outline of
+ * the new position and size, refer to the movemouse function.
  *
  * If a rule filter is NULL then it does not apply (e.g. like instance and title filters above).
  *
@@ -1025,9 +1561,10 @@ struct NumTags { char limitexceeded[LENGTH(tags) > 31 ? -1 : 1]; };
  *       const char *class;
  *       const char *instance;
  *       const char *title;
- *       unsigned int tags;
+ *       Tagset tags;
  *       int isfloating;
  *       int monitor;
+ *       int wireframe;
  *    } Rule;
  *
  * It is worth noting that when some application windows are initially mapped they may have
@@ -1037,16 +1574,17 @@ struct NumTags { char limitexceeded[LENGTH(tags) > 31 ? -1 : 1]; };
  * due to having a common launcher application named as such.
  *
  * One common misunderstanding when it comes to rules is that the tags mask is a binary mask
- * rather than just a number like 8 to place a client on tag 8. The reason for this is simply due
- * to convenience as all tags handling are binary masks, but also because a user may want to have
- * a rule that places a given client on both tag 5 and tag 7.
+ * rather than just a number like 8 to place a client on tag 8. The TAGBIT macro gives a mask
+ * for a single tag counting from 0, so TAGBIT(7) places a client on tag 8. The reason for this
+ * is simply due to convenience as all tags handling are binary masks, but also because a user
+ * may want to have a rule that places a given client on both tag 5 and tag 7.
  *
  * Also worth noting that in (ANSI) C99 you can use designated initialisers to initialise a
  * structure. What this means is that you can initialise your rules like this:
  *
  *    static const Rule rules[] = {
  *       { .class = "Gimp", .isfloating = 1, .monitor = -1 },
- *       { .class = "Firefox", .tags = 1 << 8, .monitor = -1 },
+ *       { .class = "Firefox", .tags = TAGBIT(8), .monitor = -1 },
  *    };
  *
  * Any fields that are not initialised will default to 0. This can be useful when using many
@@ -1069,13 +1607,13 @@ applyrules(Client *c)
 	const char *class, *instance;
 	unsigned int i;
 	const Rule *r;
-	Monitor *m;
 	/* Placeholder to store the client's class hints in */
 	XClassHint ch = { NULL, NULL };
 
 	/* Rule matching */
 	c->isfloating = 0;
-	c->tags = 0;
+	c->cold->wireframe = 0;
+	c->tags = (Tagset){ { 0 } };
 	/* This reads the class hint for the client's window. As in this property of
 	 * the window:
 	 *
@@ -1086,7 +1624,9 @@ applyrules(Client *c)
 	 * scenario that a window does not have this property set then the class and instance will
 	 * default to "broken".
 	 */
+	TRACEBEGIN("XGetClassHint");
 	XGetClassHint(dpy, c->win, &ch);
+	TRACEEND();
 	class    = ch.res_class ? ch.res_class : broken;
 	instance = ch.res_name  ? ch.res_name  : broken;
 
@@ -1095,7 +1635,7 @@ applyrules(Client *c)
 		/* The current rule (r) */
 		r = &rules[i];
 		/* Checking matching filters for class, instance and title. */
-		if ((!r->title || strstr(c->name, r->title))
+		if ((!r->title || strstr(c->cold->name, r->title))
 		&& (!r->class || strstr(class, r->class))
 		&& (!r->instance || strstr(instance, r->instance)))
 		{
@@ -1103,16 +1643,16 @@ applyrules(Client *c)
 			 *    - what monitor the client is to be shown on
 			 *    - tags mask
 			 *    - whether the client is floating or not
+			 *    - whether the client is moved and resized using a wireframe
 			 */
 			c->isfloating = r->isfloating;
+			c->cold->wireframe = r->wireframe;
 			/* Note that this adds rather than sets tags. */
-			c->tags |= r->tags;
-			/* This loops through all monitors trying to find one that matches the monitor
-			 * rule value. If the rule value is -1 then we simply exhaust the list and m
-			 * will be NULL and thus not set. */
-			for (m = mons; m && m->num != r->monitor; m = m->next);
-			if (m)
-				c->mon = m;
+			tagsor(&c->tags, &c->tags, &r->tags);
+			/* This looks up the monitor that matches the monitor rule value. If the rule
+			 * value is -1, or there is no such monitor, then the monitor is not set. */
+			if (r->monitor >= 0 && r->monitor < nmons)
+				c->mon = montab[r->monitor];
 			/* Note the omission of a break; here. This means that despite having found a
 			 * matching client rule we still continue looking for others. In practice what
 			 * this means is that the last rule to apply is the one that will take
@@ -1129,7 +1669,9 @@ applyrules(Client *c)
 
 	/* This guard checks whether the client is to be shown on a valid tag. If it is not
 	 * then we show the client on whatever tag(s) the client's monitor has active. */
-	c->tags = c->tags & TAGMASK ? c->tags & TAGMASK : c->mon->tagset[c->mon->seltags];
+	tagsand(&c->tags, &c->tags, &tagmask);
+	if (tagsempty(&c->tags))
+		c->tags = c->mon->tagset[c->mon->seltags];
 }
 
 /* This function assesses whether a resize for a window is needed or not considering the window's
@@ -1351,7 +1893,7 @@ applysizehints(Client *c, int *x, int *y, int *w, int *h, int interact)
  * specific monitor to the arrange function results in the above happening for that monitor and
  * in addition a restack is applied which will call drawbar.
  *
- * @called_from configurenotify if the monitor setup has changed
+ * @called_from geomtimeout if the monitor setup has changed
  * @called_from incnmaster after the number of master clients have been adjusted
  * @called_from manage upon managing a new client
  * @called_from pop in relation to a call to zoom to make a client window the new master
@@ -1370,9 +1912,10 @@ applysizehints(Client *c, int *x, int *y, int *w, int *h, int interact)
  * @calls showhide to move client windows into and out of view
  * @calls arrangemon to trigger re-arrangement of windows according to the selected layout
  * @calls restack to draw the bar and adjust which clients are shown above others
+ * @calls settimer to lay out the tags that are not viewed once dwm is idle
  *
  * Internal call stack:
- *    run -> configurenotify -> arrange
+ *    main -> run -> geomtimeout -> arrange
  *    run -> buttonpress -> tag -> arrange
  *    run -> buttonpress -> movemouse / resizemouse -> sendmon -> arrange
  *    run -> buttonpress -> movemouse / resizemouse -> togglefloating -> arrange
@@ -1395,11 +1938,21 @@ applysizehints(Client *c, int *x, int *y, int *w, int *h, int interact)
  *    run -> propertynotify -> arrange
  *    run -> clientmessage / updatewindowtype -> setfullscreen -> arrange
  *    run -> destroynotify / unmapnotify -> unmanage -> arrange
- *    main -> cleanup -> view -> arrange
  */
 void
 arrange(Monitor *m)
 {
+	TRACEBEGIN("arrange");
+	/* Anything that calls for an arrange may also have changed the layout of tags that are not
+	 * viewed, so these are laid out again once dwm has been idle for a while. Refer to the
+	 * prearrange function. */
+	if (m)
+		m->gen++;
+	else for (m = mons; m; m = m->next)
+		m->gen++;
+	if (prearrangedelay)
+		settimer(prearrangetimer, prearrangedelay);
+
 	/* If we have been given a specific monitor then call showhide to move windows into and out
 	 * of view for that monitor. */
 	if (m)
@@ -1423,6 +1976,7 @@ arrange(Monitor *m)
 	/* Otherwise we call arrangemon for all monitors */
 	} else for (m = mons; m; m = m->next)
 		arrangemon(m);
+	TRACEEND();
 }
 
 /* This sets / updates the layout symbol for the monitor and calls the layout arrange function
@@ -1438,6 +1992,7 @@ arrange(Monitor *m)
 void
 arrangemon(Monitor *m)
 {
+	TRACEBEGIN("arrangemon");
 	/* This copies the layout symbol of the selected layout to the monitor's layout string,
 	 * which is later used in drawbar when printing the layout symbol on the bar. */
 	strncpy(m->ltsymbol, m->lt[m->sellt]->symbol, sizeof m->ltsymbol);
@@ -1447,6 +2002,7 @@ arrangemon(Monitor *m)
 	 * on what layout is selected. */
 	if (m->lt[m->sellt]->arrange)
 		m->lt[m->sellt]->arrange(m);
+	TRACEEND();
 }
 
 /* This inserts a client at the top of the monitor's client list.
@@ -1476,16 +2032,22 @@ arrangemon(Monitor *m)
  *    run -> keypress -> zoom -> pop -> attach
  *    run -> keypress -> tagmon -> sendmon -> attach
  *    run -> buttonpress -> movemouse / resizemouse -> sendmon -> attach
- *    run -> configurenotify -> updategeom -> attach
+ *    main -> run -> geomtimeout -> updategeom -> attach
  */
 void
 attach(Client *c)
 {
 	/* This sets the given client's next reference to the head of the list, then it sets the
 	 * head of the list to become the given client. In practice the given client becomes the
-	 * first client in the linked list. */
+	 * first client in the linked list. The client that used to be first now refers back to the
+	 * given client. */
+	c->prev = NULL;
 	c->next = c->mon->clients;
+	if (c->next)
+		c->next->prev = c;
 	c->mon->clients = c;
+	c->mon->visvalid = 0;
+	counttags(c, 1);
 }
 
 /* This inserts a client at the top of the monitor's stacking order.
@@ -1505,7 +2067,7 @@ attach(Client *c)
  *    run -> maprequest -> manage -> attachstack
  *    run -> keypress -> tagmon -> sendmon -> attachstack
  *    run -> buttonpress -> movemouse / resizemouse -> sendmon -> attachstack
- *    run -> configurenotify -> updategeom -> attachstack
+ *    main -> run -> geomtimeout -> updategeom -> attachstack
  */
 void
 attachstack(Client *c)
@@ -1513,13 +2075,16 @@ attachstack(Client *c)
 	/* This sets the given client's snext reference to the head of the list, then it sets the
 	 * head of the list to become the given client. In practice the given client becomes the
 	 * first client in the stack. */
+	c->sprev = NULL;
 	c->snext = c->mon->stack;
+	if (c->snext)
+		c->snext->sprev = c;
 	c->mon->stack = c;
 }
 
 /* This handles ButtonPress events coming from the X server.
  *
- * Most of this function has to do with working out what exactly the user clicked on, which is
+ * Part of this function has to do with working out what exactly the user clicked on, which is
  * represented by the clicks enum:
  *
  *    enum { ClkTagBar, ClkLtSymbol, ClkStatusText, ClkWinTitle,
@@ -1532,7 +2097,7 @@ attachstack(Client *c)
  *      -- one of the tag icons or
  *      -- the layout symbol or
  *      -- the window title or
- *      -- the status text
+ *      -- the status text, or one of the segments of the status text
  *
  * Once that is known it will loop through all the button bindings as defined in the buttons array
  * in the configuration file to look for bindings that match the click type combined with the mouse
@@ -1544,6 +2109,7 @@ attachstack(Client *c)
  *
  * @called_from run (the event handler)
  * @calls XAllowEvents https://tronche.com/gui/x/xlib/input/XAllowEvents.html
+ * @calls settimer to cancel any pending focus change caused by the mouse cursor entering a window
  * @calls wintomon to check whether the button click happened on another monitor
  * @calls wintoclient to check whether the button click was on a client window
  * @calls focus to change focus to a different client or a different monitor
@@ -1558,14 +2124,24 @@ attachstack(Client *c)
 void
 buttonpress(XEvent *e)
 {
-	unsigned int i, x, click;
-	Arg arg = {0}; /* Argument to store the tag index in case the user clicks on a tag icon */
+	unsigned int i, click;
+	int lo, hi, mid;
+	Arg arg = {0}; /* Argument to store the tag bitmask or the status text segment index */
 	Client *c;
 	Monitor *m;
 	XButtonPressedEvent *ev = &e->xbutton;
+#ifdef STATS
+	unsigned long t;
+#endif /* STATS */
 
 	/* Default to clicking on the root window, as in the background wallpaper */
 	click = ClkRootWin;
+	/* A click takes precedence over the mouse cursor resting on a window, so cancel any pending
+	 * focus change. The click itself gives focus to the window that was clicked on. */
+	if (hoverwin != None) {
+		hoverwin = None;
+		settimer(hovertimer, 0);
+	}
 	/* If the button click was on a monitor other than the currently focused monitor, then
 	 * change the selected monitor to the monitor the user clicked on. */
 	if ((m = wintomon(ev->window)) && m != selmon) {
@@ -1583,50 +2159,29 @@ buttonpress(XEvent *e)
 	/* This checks if the mouse click was on the bar, in which case we need to work out what
 	 * part of the bar the user clicked on. */
 	if (ev->window == selmon->barwin) {
-		/* This section of code calculates what the user clicked on by looking at the text
-		 * width of tag icons, the layout symbol and the status text.
-		 *
-		 * In practice you may think of it as going through the same steps as drawing the
-		 * bar, but this time we only calculate where things would have been drawn if we
-		 * were to draw them. As such the following code must mirror exactly what the
-		 * drawbar function does as otherwise that can lead to mouse click misalignment.
-		 */
-		i = x = 0;
-		/* This do while loop goes through each tag icon and increments x with the width of
-		 * the tag. Then it will check if the x position is larger than the mouse click
-		 * position and if it is then it will break out of the while loop.
+		/* The drawbar function records the regions of the bar as it lays them out, so
+		 * rather than working out where things would have been drawn we only need to find
+		 * the region the mouse click position falls within. The regions are ordered from left
+		 * to right, so a binary search gives us the first region that ends after the click
+		 * position.
 		 *
-		 * On the other hand if it is not then it will increment the iterator i and continue
-		 * with the next tag icon until it has gone through all tags.
+		 * The region also holds the argument to pass on to the button binding function,
+		 * which is the tag bitmask for tags and the segment index for the status text. The
+		 * view, toggleview, tag and toggletag functions takes a bitmask argument rather than
+		 * a simple index, e.g. when the user clicks on tag 6 then the argument would have
+		 * a binary bitmask value of 00100000.
 		 */
-		do
-			x += TEXTW(tags[i]);
-		while (ev->x >= x && ++i < LENGTH(tags));
-		/* If the previous do while loop stopped before it had gone through all tags then
-		 * that means that the user clicked on one of the tags in the bar. */
-		if (i < LENGTH(tags)) {
-			/* We set the click type to ClkTagBar to indicate that the user clicked on
-			 * one of the tags, and the i iterator shows what tag was clicked. */
-			click = ClkTagBar;
-			/* The view, toggleview, tag and toggletag functions takes a bitmask argument
-			 * rather than a simple index hence we do a binary shift when setting the
-			 * argument for those functions. E.g. when the user clicks on tag 6 then the
-			 * iterator i will be 5, and shifting 1 five times to the left gives a binary
-			 * bitmask value of 00100000. */
-			arg.ui = 1 << i;
-		/* If we did exhaust all the tag icons then we check if the user must have clicked
-		 * on the layout symbol. */
-		} else if (ev->x < x + TEXTW(selmon->ltsymbol))
-			click = ClkLtSymbol;
-		/* If the click was to the right of the layout symbol then we need to check if the
-		 * click was on the status text, which is drawn to the far right of the bar. We do
-		 * not actually know the width of the client window title */
-		else if (ev->x > selmon->ww - (int)TEXTW(stext))
-			click = ClkStatusText;
-		/* The click was not to the left and not to the right, so the click must have been
-		 * on the window title. */
-		else
-			click = ClkWinTitle;
+		for (lo = 0, hi = selmon->nregions; lo < hi;) {
+			mid = (lo + hi) / 2;
+			if (selmon->regions[mid].x <= ev->x)
+				lo = mid + 1;
+			else
+				hi = mid;
+		}
+		if (lo < selmon->nregions) {
+			click = selmon->regions[lo].click;
+			arg = selmon->regions[lo].arg;
+		}
 	/* If the click was not on the bar window then check if the click was on one of the client
 	 * windows. If it was not then the click is assumed to have been on the root window. */
 	} else if ((c = wintoclient(ev->window))) {
@@ -1670,11 +2225,20 @@ buttonpress(XEvent *e)
 		 * button combinations to cover this.
 		 */
 		if (click == buttons[i].click && buttons[i].func && buttons[i].button == ev->button
-		&& CLEANMASK(buttons[i].mask) == CLEANMASK(ev->state))
+		&& CLEANMASK(buttons[i].mask) == CLEANMASK(ev->state)) {
+#ifdef STATS
+			t = statsnow();
+#endif /* STATS */
 			/* If we have a match then we call the associated function with the given
-			 * argument, unless the user clicked on the tags in which case we pass the
-			 * argument with the bitmask we set previously. */
-			buttons[i].func(click == ClkTagBar && buttons[i].arg.i == 0 ? &arg : &buttons[i].arg);
+			 * argument, unless the user clicked on the tags or the status text and the
+			 * binding has no argument, in which case we pass the argument of the bar
+			 * region (the tag bitmask or the status text segment index). */
+			buttons[i].func((click == ClkTagBar || click == ClkStatusText) && buttons[i].arg.i == 0
+				? &arg : &buttons[i].arg);
+#ifdef STATS
+			histadd(&buttonstats[i], statsnow() - t);
+#endif /* STATS */
+		}
 			/* Note that there is no break; following this, which means that we will
 			 * continue searching through the button bindings for more matches. As such
 			 * it is possible to have more than one thing happen when a button is clicked
@@ -1735,10 +2299,11 @@ checkotherwm(void)
  * @calls XSetInputFocus https://tronche.com/gui/x/xlib/input/XSetInputFocus.html
  * @calls XSync https://tronche.com/gui/x/xlib/event-handling/XSync.html
  * @calls XUngrabKey https://tronche.com/gui/x/xlib/input/XUngrabKey.html
- * @calls view to bring all clients into view
- * @calls unmanage to stop managing all windows managed by the window manager
+ * @calls unmanageall to stop managing all windows managed by the window manager
  * @calls cleanupmon to tear down each monitor
+ * @calls pooldestroy to free the memory used for clients and monitors
  * @calls drw_cur_free to free all mouse cursor options
+ * @calls XFreeGC https://tronche.com/gui/x/xlib/GC/XFreeGC.html
  * @calls drw_free to free the drawable
  * @calls free to memory used by the colour schemes
  *
@@ -1748,40 +2313,41 @@ checkotherwm(void)
 void
 cleanup(void)
 {
-	/* This sets up an argument that will select all tags */
-	Arg a = {.ui = ~0};
-	Layout foo = { "", NULL }; /* A dummy floating layout */
-	Monitor *m;
 	size_t i;
 
-	/* This calls view with the argument that selects and views all tags. This is what makes
-	 * dwm briefly show all client windows for a fraction of a second when exiting.
-	 *
-	 * The purpose of this may not be obvious, but it has to do with how dwm hides client
-	 * windows by moving them to a negative x position. In principle the X session could be
-	 * taken over by another window manager, which would cause some issues and/or confusion
-	 * given that some windows will be in an unreachable location.
-	 *
-	 * As such the view call here makes sure to pull all clients into view before dwm exits.
-	 */
-	view(&a);
-	/* This sets the selected monitor's layout to the dummy floating layout. The purpose of
-	 * this is presumably to negate a flood of arrange calls when calling unmanage for each
-	 * client. If that is the case then it would make more sense having this inside the for
-	 * loop so that this applies to all monitors when exiting, not just the selected one. */
-	selmon->lt[selmon->sellt] = &foo;
-	/* Loop through each monitor and unmanage all clients until the stack is exhausted */
-	for (m = mons; m; m = m->next)
-		while (m->stack)
-			unmanage(m->stack, 0);
+	/* Stop managing all clients, pulling hidden clients back into view, refer to the
+	 * unmanageall function. */
+	unmanageall();
+#ifdef TRACE
+	/* Finish the trace if tracing was still on */
+	if (tracing)
+		traceclose();
+#endif /* TRACE */
 	/* This releases any keybindings (grabbed keys) */
 	XUngrabKey(dpy, AnyKey, AnyModifier, root);
 	/* Loop through and tear down all monitors */
 	while (mons)
 		cleanupmon(mons);
+#ifdef STATS
+	/* Report how much memory the client and monitor pools used at most, refer to poolalloc */
+	fprintf(stderr, "dwm: memory: %zu clients (%zu slabs), %zu cold (%zu slabs), "
+		"%zu monitors (%zu slabs), %zu bytes\n",
+		clientpool.maxused, clientpool.nslabs, coldpool.maxused, coldpool.nslabs,
+		monpool.maxused, monpool.nslabs,
+		poolbytes(&clientpool) + poolbytes(&coldpool) + poolbytes(&monpool));
+#endif /* STATS */
+	free(montab);
+	free(gridmons);
+	free(wintab);
+	/* All clients and monitors have been freed by now, so the pools can go */
+	pooldestroy(&clientpool);
+	pooldestroy(&coldpool);
+	pooldestroy(&monpool);
 	/* Loop through and free each cursor */
 	for (i = 0; i < CurLast; i++)
 		drw_cur_free(drw, cursor[i]);
+	/* Free the graphics context used for wireframe outlines */
+	XFreeGC(dpy, wiregc);
 	/* Loop through and free each colour scheme */
 	for (i = 0; i < LENGTH(colors); i++)
 		free(scheme[i]);
@@ -1799,6 +2365,25 @@ cleanup(void)
 	/* This deletes the _NET_ACTIVE_WINDOW property of the root window as the window manager
 	 * no longer manages any windows. */
 	XDeleteProperty(dpy, root, netatom[NetActiveWindow]);
+	/* Close the event sources and the epoll instance. The X connection is the only source
+	 * without a function and it is closed separately when the display is closed. */
+	for (i = 0; i < nsources; i++)
+		if (sources[i].func)
+			close(sources[i].fd);
+	close(dragtimer);
+	close(epfd);
+	/* Free the key table, refer to the grabkeys function */
+	free(keytab);
+#ifdef STATS
+	/* Report the input latency statistics recorded in the run function */
+	if (inputlat.hist.count)
+		fprintf(stderr, "dwm: input latency: %lu events, avg %lu us, max %lu us\n",
+			inputlat.hist.count, inputlat.hist.sum / inputlat.hist.count / 1000,
+			inputlat.hist.max / 1000);
+	/* Remove the statistics file so that stale statistics are not picked up */
+	if (*statspath)
+		unlink(statspath);
+#endif /* STATS */
 }
 
 /* This function deals with tearing down a monitor which involves:
@@ -1810,10 +2395,10 @@ cleanup(void)
  * @called_from updategeom to delete bar windows and free memory in the event of less monitors
  * @calls XUnmapWindow https://tronche.com/gui/x/xlib/window/XUnmapWindow.html
  * @calls XDestroyWindow https://tronche.com/gui/x/xlib/window/XDestroyWindow.html
- * @calls free to release memory used by the given monitor struct
+ * @calls poolfree to release memory used by the given monitor struct
  *
  * Internal call stack:
- *    run -> configurenotify -> updategeom -> cleanupmon
+ *    main -> run -> geomtimeout -> updategeom -> cleanupmon
  *    main -> cleanup -> cleanupmon
  */
 void
@@ -1850,11 +2435,19 @@ cleanupmon(Monitor *mon)
 		m->next = mon->next;
 	}
 	/* Call to unmap the window so that it is no longer shown */
+	windel(mon->barwin);
+	windel(mon->deskwin);
 	XUnmapWindow(dpy, mon->barwin);
 	/* Call to destroy the window */
 	XDestroyWindow(dpy, mon->barwin);
-	/* Finally free up memory used by the monitor struct */
-	free(mon);
+	/* Call to destroy the desktop window */
+	XDestroyWindow(dpy, mon->deskwin);
+	/* Finally free up memory used by the bar regions and the monitor struct */
+	free(mon->regions);
+	free(mon->vis);
+	free(mon->tiled);
+	free(mon->pertag);
+	poolfree(&monpool, mon);
 }
 
 /* This handles ClientMessage events coming from the X server.
@@ -1880,10 +2473,20 @@ cleanupmon(Monitor *mon)
 void
 clientmessage(XEvent *e)
 {
+	Tagset urg;
 	XClientMessageEvent *cme = &e->xclient;
 	/* Find the client the window is in relation to. */
 	Client *c = wintoclient(cme->window);
 
+#ifdef STATS
+	/* A program asks for the statistics by sending a _DWM_STATS message to the root window,
+	 * refer to the updatestats function. */
+	if (cme->window == root && cme->message_type == statsatom) {
+		updatestats();
+		return;
+	}
+#endif /* STATS */
+
 	/* If we are not managing this window then ignore the event. */
 	if (!c)
 		return;
@@ -1962,8 +2565,14 @@ clientmessage(XEvent *e)
 	 *    0x5a00006
 	 */
 	} else if (cme->message_type == netatom[NetActiveWindow]) {
-		if (c != selmon->sel && !c->isurgent)
+		if (c != selmon->sel && !c->isurgent) {
+			urg = c->mon->urg;
 			seturgent(c, 1);
+			/* The bar only needs to be redrawn if the tag now has an urgent client
+			 * where it did not before. */
+			if (!tagsequal(&c->mon->urg, &urg))
+				drawbar(c->mon);
+		}
 	}
 }
 
@@ -2012,71 +2621,37 @@ configure(Client *c)
  * This can happen for example if you run an xrandr command that enables a monitor or
  * changes resolution. Only ConfigureNotify events for the root window are handled.
  *
+ * Such changes tend to come with a burst of events, e.g. when docking a laptop, so rather than
+ * updating the monitors for every event the geometry timer is started (or restarted), and the
+ * monitors are updated once when no more events have come in for geomdelay milliseconds. Refer
+ * to the geomtimeout function.
+ *
  * @called_from run (the event handler)
- * @calls updategeom to update the number of monitors, their sizes and positions
- * @calls drw_resize to adjust the drawable space
- * @calls updatebars to create new bar windows in case we have new monitors
- * @calls resizeclient to restore fullscreen client windows
- * @calls XMoveResizeWindow https://tronche.com/gui/x/xlib/window/XMoveResizeWindow.html
- * @calls focus to give back input focus to the last used window as it may have been lost
- * @calls arrange to resize and reposition tiled clients as the monitor may have changed
+ * @calls settimer to update the monitors once the events have settled
+ * @calls geomtimeout to update the monitors straight away if geomdelay is 0
  *
  * Internal call stack:
- *    run -> configurenotify -> updategeom
+ *    run -> configurenotify
  */
 void
 configurenotify(XEvent *e)
 {
-	Monitor *m;
-	Client *c;
 	XConfigureEvent *ev = &e->xconfigure;
-	int dirty;
 
-	/* TODO: updategeom handling sucks, needs to be simplified (famous last words) */
 	if (ev->window == root) {
 		/* If the width and height of the event differs from the stored screen width and
-		 * height then we will want do the corrections in the if statement below regardless
-		 * of whether updategeom detects a change in the number of monitors. We could just
-		 * have a case of the resolution of the monitor changing. */
-		dirty = (sw != ev->width || sh != ev->height);
+		 * height then we will want to do the corrections in geomtimeout regardless of
+		 * whether updategeom detects a change in the monitors. We could just have a case of
+		 * the resolution of the monitor changing. */
+		if (sw != ev->width || sh != ev->height)
+			sizechanged = 1;
 		/* This updates the screen width and the sceen height global variables */
 		sw = ev->width;
 		sh = ev->height;
-		/* Have updategeom run a check to see if we have any new or less monitors and
-		 * enter regardless if the screen size has changed. */
-		if (updategeom() || dirty) {
-			/* This next line changes the screen drawable area. That it resizes the
-			 * drawable area to be the height of the bar is most likely a bug considering
-			 * that the drawable area is created with the dimensions of the screen in the
-			 * setup function:
-			 *
-			 *    drw = drw_create(dpy, screen, root, sw, sh);
-			 *
-			 * This does not seem to affect the operability of dwm, however, as all that
-			 * the window manager draws is the bar which does not exceed the bar height.
-			 */
-			drw_resize(drw, sw, bh);
-			/* This call to updatebars is to create new bar windows in the event that the
-			 * call to updategeom resulted in new monitors to be created. */
-			updatebars();
-			/* Loop through each monitor to make correction */
-			for (m = mons; m; m = m->next) {
-				/* For every client on the monitor check to see if any of them was in
-				 * fullscreen and if so then resize them to restore fullscreen. */
-				for (c = m->clients; c; c = c->next)
-					if (c->isfullscreen)
-						resizeclient(c, m->mx, m->my, m->mw, m->mh);
-				/* This resizes and repositions the bar according to the new
-				 * position and size of the monitor. */
-				XMoveResizeWindow(dpy, m->barwin, m->wx, m->by, m->ww, bh);
-			}
-			/* Give focus back to the last viewed client in case input focus got lost
-			 * as part of the monitor updates. */
-			focus(NULL);
-			/* A final arrange call to resize and reposition tiled clients following the
-			 * monitor changes. */
-			arrange(NULL);
-		}
+		if (geomdelay)
+			settimer(geomtimer, geomdelay);
+		else
+			geomtimeout();
 	}
 }
 
@@ -2127,25 +2702,25 @@ configurerequest(XEvent *e)
 			 * the window to move to an unexpected location depending on monitor setup.
 			 */
 			if (ev->value_mask & CWX) {
-				c->oldx = c->x;
+				c->cold->oldx = c->x;
 				c->x = m->mx + ev->x;
 			}
 
 			/* The same applies if the event includes a position on the Y axis. */
 			if (ev->value_mask & CWY) {
-				c->oldy = c->y;
+				c->cold->oldy = c->y;
 				c->y = m->my + ev->y;
 			}
 
 			/* If the event includes information on a new width then accept that. */
 			if (ev->value_mask & CWWidth) {
-				c->oldw = c->w;
+				c->cold->oldw = c->w;
 				c->w = ev->width;
 			}
 
 			/* If the event includes information on a new height then accept that. */
 			if (ev->value_mask & CWHeight) {
-				c->oldh = c->h;
+				c->cold->oldh = c->h;
 				c->h = ev->height;
 			}
 
@@ -2200,7 +2775,103 @@ configurerequest(XEvent *e)
 
 	/* This flushes the output buffer and then waits until all requests have been received and
 	 * processed by the X server. */
+	TRACEBEGIN("XSync");
 	XSync(dpy, False);
+	TRACEEND();
+}
+
+/* This adds or removes a client from the per tag client counts of the client's monitor.
+ *
+ * Every monitor keeps a count of the clients on each tag as well as a count of the urgent clients
+ * on each tag. When a count goes from 0 to 1 or from 1 to 0 then the corresponding bit in the
+ * occ (occupied) or urg (urgent) bitmask of the monitor is flipped. The drawbar function uses
+ * these bitmasks rather than going through all clients every time the bar is drawn.
+ *
+ * The counts must be kept in sync with the client list, which means that this must be called
+ * with an increment of -1 before changing the tags or the urgency of a client that is in the
+ * client list, and with an increment of 1 afterwards. The attach and detach functions handle the
+ * counts for clients that are added to or removed from the client list.
+ *
+ * @called_from attach to add the client to the counts
+ * @called_from detach to remove the client from the counts
+ * @called_from tag and toggletag when the tags of a client change
+ * @called_from seturgent and propertynotify when the urgency of a client changes
+ *
+ * Internal call stack:
+ *    ~ -> attach / detach -> counttags
+ *    ~ -> focus -> seturgent -> counttags
+ *    run -> keypress -> tag / toggletag -> counttags
+ *    run -> propertynotify -> counttags
+ */
+void
+counttags(Client *c, int inc)
+{
+	Monitor *m = c->mon;
+	unsigned int i;
+
+	for (i = 0; i < LENGTH(tags); i++) {
+		/* Skip ahead a whole word at a time when there are many tags. */
+		if (!c->tags.w[i / 64]) {
+			i |= 63;
+			continue;
+		}
+		if (!tagstest(&c->tags, i))
+			continue;
+		if ((m->nocc[i] += inc))
+			tagsset(&m->occ, i);
+		else
+			tagsclear(&m->occ, i);
+		if (!c->isurgent)
+			continue;
+		if ((m->nurg[i] += inc))
+			tagsset(&m->urg, i);
+		else
+			tagsclear(&m->urg, i);
+	}
+}
+
+/* This sets up the _NET_WM_SYNC_REQUEST handshake with a client that is about to be resized using
+ * the mouse.
+ *
+ * The _NET_WM_SYNC_REQUEST protocol works like this:
+ *    - the client creates an XSync counter and stores the ID of the counter in the
+ *      _NET_WM_SYNC_REQUEST_COUNTER property of the client window
+ *    - before resizing the client the window manager sends a _NET_WM_SYNC_REQUEST client message
+ *      that holds a value that is higher than the current value of the counter
+ *    - when the client has handled the resize and has redrawn its window it sets the counter to
+ *      that value
+ *
+ * Rather than polling the counter we create an XSync alarm that triggers when the counter reaches
+ * the expected value, which results in an XSyncAlarmNotify event. The value that the alarm waits
+ * for is updated every time a new request is sent, refer to the syncresize function.
+ *
+ * @called_from resizemouse to set up the handshake before resizing the client
+ * @calls XSyncQueryCounter https://www.x.org/releases/current/doc/xextproto/sync.html
+ * @calls XSyncCreateAlarm https://www.x.org/releases/current/doc/xextproto/sync.html
+ * @returns the alarm, or None if the current value of the counter could not be read
+ *
+ * Internal call stack:
+ *    run -> buttonpress -> resizemouse -> createalarm
+ */
+XSyncAlarm
+createalarm(Client *c)
+{
+	XSyncAlarmAttributes aa;
+	int ret;
+
+	TRACEBEGIN("XSyncQueryCounter");
+	ret = XSyncQueryCounter(dpy, c->cold->synccounter, &c->cold->syncvalue);
+	TRACEEND();
+	if (!ret)
+		return None;
+
+	aa.trigger.counter = c->cold->synccounter;
+	aa.trigger.value_type = XSyncAbsolute;
+	aa.trigger.wait_value = c->cold->syncvalue;
+	aa.trigger.test_type = XSyncPositiveComparison;
+	aa.events = True;
+	return XSyncCreateAlarm(dpy, XSyncCACounter|XSyncCAValueType|XSyncCAValue
+		|XSyncCATestType|XSyncCAEvents, &aa);
 }
 
 /* This creates and returns a new monitor structure.
@@ -2208,24 +2879,26 @@ configurerequest(XEvent *e)
  * The monitor's position and size are set in the updategeom function which handles monitor setup.
  *
  * @called_from updategeom to create new monitors
- * @calls ecalloc to allocate memory for the new structure (see util.c)
+ * @calls poolalloc to allocate memory for the new structure (see util.c)
+ * @calls ecalloc to allocate memory for the bar regions and the per tag state (see util.c)
  * @calls strncpy to copy the default layout symbol into the monitor layout symbol
  *
  * Internal call stack:
- *    run -> configurenotify -> updategeom -> createmon
+ *    main -> run -> geomtimeout -> updategeom -> createmon
  *    main -> setup -> updategeom -> createmon
  */
 Monitor *
 createmon(void)
 {
 	Monitor *m;
+	unsigned int i;
 
 	/* Allocate memory to hold the new monitor. */
-	m = ecalloc(1, sizeof(Monitor));
+	m = poolalloc(&monpool);
 
 	/* This sets the current and previous tagset to 1, as in the first tag is selected by
 	 * default. */
-	m->tagset[0] = m->tagset[1] = 1;
+	m->tagset[0] = m->tagset[1] = tagbits[0];
 
 	/* We set the default master / stack factor, number of clients in the master area, whether
 	 * to show the bar by default and its location based on the corresponding variables set in
@@ -2246,6 +2919,22 @@ createmon(void)
 	/* This copies the layout symbol from the first layout into the monitor's layout symbol.
 	 * This is later used when drawing the layout symbol on the bar. */
 	strncpy(m->ltsymbol, layouts[0].symbol, sizeof m->ltsymbol);
+	/* Until we know better assume the default refresh rate, refer to updaterefresh. */
+	m->refresh = refreshrate;
+	/* The bar has a region for each tag, the layout symbol, the window title and each status
+	 * text segment, of which there can be at most one per character. */
+	m->regions = ecalloc(LENGTH(tags) + 2 + LENGTH(stext), sizeof(BarRegion));
+
+	/* Every tag starts out with the default layout state, refer to the pertagview function. */
+	m->pertag = ecalloc(LENGTH(tags) + 1, sizeof(Pertag));
+	for (i = 0; i <= LENGTH(tags); i++) {
+		m->pertag[i].nmaster = m->nmaster;
+		m->pertag[i].mfact = m->mfact;
+		m->pertag[i].lt[0] = m->lt[0];
+		m->pertag[i].lt[1] = m->lt[1];
+		m->pertag[i].showbar = m->showbar;
+	}
+	m->curtag = 1;
 
 	/* Return the newly created monitor. */
 	return m;
@@ -2298,68 +2987,21 @@ destroynotify(XEvent *e)
 void
 detach(Client *c)
 {
-	Client **tc;
-
-	/* The use of double pointers (**tc) can make this piece of code challenging to read
-	 * for users new to C who may not be that well versed in pointers and references.
-	 *
-	 * The problem scenario:
-	 *    - we need to find the given client (c) in a linked list
-	 *    - c refers to the next client in the list (n)
-	 *    - then we to find the client prior (p) to client c
-	 *    - then we need to have p refer to n instead of c in order to skip c
-	 *
-	 * An example implementation may look something like this:
-	 *
-	 *    Client *tc, *p;
-	 *
-	 *    if (c == c->mon->clients)
-	 *       c->mon->clients = c->next;
-	 *    else {
-	 *       for (tc = c->mon->clients; tc && tc != c; p = tc && tc = tc->next);
-	 *       p->next = c->next;
-	 *    }
-	 *
-	 * By using double pointers the above is written with less lines of code as we are
-	 * playing around with pointer addresses directly.
-	 *
-	 * Let's try to break this down.
-	 *
-	 * The variable **tc is declared as a pointer to a pointer to variable of type Client.
-	 *
-	 * The Monitor struct holds a pointer *clients to a variable of type Client.
-	 *
-	 * The tc variable is set to point to the address of c->mon->clients, as in it is pointing
-	 * to the pointer in the Monitor struct.
-	 *    tc = &c->mon->clients
-	 *
-	 * If c->mon->clients point to NULL or c->mon->clients is the given client, then stop
-	 * the for loop.
-	 *    *tc && *tc != c
-	 *
-	 * If the first client was the given client, then tc will still be referring to the
-	 * pointer of c->mon->clients. So the next line would then just change the pointer of
-	 * c->mon->clients to point to c->next.
-	 *    *tc = c->next;
+	/* As the list is doubly linked the client knows both its neighbours, so it can be taken out
+	 * of the list without searching for it, regardless of how many clients there are.
 	 *
-	 * But in the event that the given client was not the first client in the list we change
-	 * tc to point to the address (&) of the pointer to the next client in the list.
-	 *    &(*tc)->next
-	 *
-	 * When we hit the condition again we check if that next pointer points to NULL or if it
-	 * points to the given client.
-	 *    *tc && *tc != c
-	 *
-	 * If it doesn't then we keep moving the iterator from the next pointer to the next pointer
-	 * rather than client to client until we find that the current next pointer refers to the
-	 * given client, at which point we exit the for loop.
-	 *
-	 * What happens next is that we make the pointer pointing to the given client point to the
-	 * next client in the list instead.
-	 *    *tc = c->next;
+	 * The client before the given client (or the head of the list if the given client is the
+	 * first client) is made to refer to the client after the given client, and the client after
+	 * the given client (if any) is made to refer back to the client before it.
 	 */
-	for (tc = &c->mon->clients; *tc && *tc != c; tc = &(*tc)->next);
-	*tc = c->next;
+	if (c->prev)
+		c->prev->next = c->next;
+	else
+		c->mon->clients = c->next;
+	if (c->next)
+		c->next->prev = c->prev;
+	c->mon->visvalid = 0;
+	counttags(c, -1);
 }
 
 /* This removes a client from the monitor's stacking order.
@@ -2378,19 +3020,25 @@ detach(Client *c)
  *    run -> keypress -> tagmon -> sendmon -> detachstack
  *    run -> buttonpress -> movemouse / resizemouse -> sendmon -> detachstack
  *    run -> destroynotify / unmapnotify -> unmanage -> detachstack
- *    run -> configurenotify -> updategeom -> detachstack
+ *    main -> run -> geomtimeout -> updategeom -> detachstack
  */
 void
 detachstack(Client *c)
 {
-	Client **tc, *t;
+	Client *t;
 
 	/* For a breakdown of what this does refer to the writeup in the detach function. */
-	for (tc = &c->mon->stack; *tc && *tc != c; tc = &(*tc)->snext);
-	*tc = c->snext;
+	if (c->sprev)
+		c->sprev->snext = c->snext;
+	else
+		c->mon->stack = c->snext;
+	if (c->snext)
+		c->snext->sprev = c->sprev;
 
 	/* Additionally if the client being removed happens to be the selected client, then find
-	 * the next visible client in the stack and set that to become the selected client. */
+	 * the next visible client in the stack and set that to become the selected client. The
+	 * selected client thereby serves as the cursor for what is to receive focus next, refer to
+	 * the unmanage function. */
 	if (c == c->mon->sel) {
 		for (t = c->mon->stack; t && !ISVISIBLE(t); t = t->snext);
 		c->mon->sel = t;
@@ -2412,40 +3060,130 @@ detachstack(Client *c)
 Monitor *
 dirtomon(int dir)
 {
-	Monitor *m = NULL;
-
-	/* If we are looking for the next monitor ... */
-	if (dir > 0) {
-		/* ... then that makes things fairly easy, just pick the monitor coming after the
-		 * selected monitor, but if this is the last monitor then pick the first monitor. */
-		if (!(m = selmon->next))
-			m = mons;
-	/* Otherwise if we are looking for the previous monitor then we first need to check if the
-	 * current monitor is the first monitor ... */
-	} else if (selmon == mons)
-		/* ... if it is then we loop through until we find the last monitor (which is not
-		 * followed by another monitor). */
-		for (m = mons; m->next; m = m->next);
-	else
-		/* If it isn't then loop through all monitors until we find the one that comes before
-		 * the current monitor. */
-		for (m = mons; m->next != selmon; m = m->next);
-	return m;
+	/* As the monitors are held in an array, the next monitor is simply the one with the next
+	 * index and the previous monitor the one with the previous index. When going past the last
+	 * monitor we wrap around to the first monitor and vice versa. Adding nmons - 1 rather than
+	 * subtracting 1 avoids a negative index for the first monitor. */
+	return montab[(selmon->num + (dir > 0 ? 1 : nmons - 1)) % nmons];
 }
 
-/* This function handles the drawing of the bar.
+/* This returns the next event that the movemouse and resizemouse functions handle while a window
+ * is being moved or resized using the mouse, and paces the handling of MotionNotify events.
+ *
+ * Motion notify events can come in quick, very quick in fact, and moving or resizing a window
+ * more often than the monitor can show it is wasted effort. Heavy clients may also struggle to
+ * keep up with being resized that often.
+ *
+ * When a MotionNotify event is returned we first skip ahead to the latest MotionNotify event at
+ * the head of the event queue, which means that the window always ends up following the latest
+ * position of the mouse cursor. Refer to the ismotionhead function.
+ *
+ * If throttling is requested and the previous motion was handled less than a frame ago, as per
+ * the refresh rate of the monitor that the mouse cursor is on, then the motion is held back and
+ * the drag timer is started for the remainder of the frame. The held back motion is returned when
+ * the timer expires, or before any other event that comes in before then so that events are still
+ * handled in order. This is unlike skipping events based on their time, which can leave the window
+ * trailing behind the mouse cursor when the mouse stops moving. The layout of the monitor can
+ * limit the rate further, refer to the Layout struct.
+ *
+ * While waiting we poll the X connection and the drag timer rather than sleep, so that other
+ * events handled by the drag loops are not held up. If a deadline is given then we stop waiting
+ * once it has passed, which resizemouse uses to stop waiting for clients that are slow to catch
+ * up with a resize even when the mouse is no longer moving.
+ *
+ * @called_from movemouse to get the next event while moving a window
+ * @called_from resizemouse to get the next event while resizing a window
+ * @calls XCheckIfEvent https://tronche.com/gui/x/xlib/event-handling/manipulating-event-queue/XCheckIfEvent.html
+ * @calls XPutBackEvent https://tronche.com/gui/x/xlib/event-handling/XPutBackEvent.html
+ * @calls poll https://man7.org/linux/man-pages/man2/poll.2.html
+ * @calls read https://man7.org/linux/man-pages/man2/read.2.html
+ * @calls recttomon to find the monitor the mouse cursor is on
+ * @calls settimer to start and stop the drag timer
+ * @calls nowms to get the current time
+ * @calls die in the event that poll fails
+ * @returns 1 if an event was returned, 0 if the deadline passed first
  *
- * The logic that is applied here with regards to what is drawn must be accurately reflected in the
- * buttonpress function which works out what the user clicked on by going through the same logical
- * steps without drawing anything.
- *
- * @called from drawbars to update the bars on all monitors
- * @called from expose if the bar window is exposed (damaged)
- * @called from propertynotify if the selected client's title changes
- * @called from restack for convenience
- * @called from setlayout to update the bar after layout update
- * @called from updatestatus to update the bar after status update
- * @calls drw_setscheme to set the next colour scheme
+ * Internal call stack:
+ *    run -> buttonpress -> movemouse / resizemouse -> dragevent
+ */
+int
+dragevent(XEvent *ev, int throttle, long deadline)
+{
+	struct pollfd fds[2] = { { ConnectionNumber(dpy), POLLIN, 0 }, { dragtimer, POLLIN, 0 } };
+	uint64_t expirations;
+	unsigned int rate;
+	long frame, wait, now;
+	Monitor *m;
+	XEvent next;
+	int stop;
+
+	for (;;) {
+		if (!XCheckIfEvent(dpy, ev, isdragevent, NULL)) {
+			/* Nothing to handle yet, wait for the X server, for the drag timer if a
+			 * motion is being held back, or until the deadline if there is one. */
+			now = nowms();
+			if (deadline && now >= deadline)
+				return 0;
+			if (poll(fds, motionheld ? 2 : 1, deadline ? deadline - now : -1) == -1
+			&& errno != EINTR)
+				die("poll:");
+			if (!motionheld || read(dragtimer, &expirations, sizeof expirations) != sizeof expirations)
+				continue;
+			*ev = heldmotion;
+		} else if (motionheld && ev->type != MotionNotify) {
+			/* Handle the held back motion before the event that came in after it. */
+			XPutBackEvent(dpy, ev);
+			*ev = heldmotion;
+		} else if (ev->type != MotionNotify) {
+			return 1;
+		} else {
+			/* Skip ahead to the latest MotionNotify event at the head of the queue. */
+			for (stop = 0; XCheckIfEvent(dpy, &next, ismotionhead, (XPointer)&stop); stop = 0)
+				*ev = next;
+
+			m = recttomon(ev->xmotion.x_root, ev->xmotion.y_root, 1, 1);
+			rate = m->refresh;
+			if (m->lt[m->sellt]->maxrate && m->lt[m->sellt]->maxrate < rate)
+				rate = m->lt[m->sellt]->maxrate;
+			frame = 1000 / MAX(rate, 1);
+			wait = frame - (nowms() - motiontime);
+			if (throttle && wait > 0) {
+				heldmotion = *ev;
+				motionheld = 1;
+				settimer(dragtimer, wait);
+				continue;
+			}
+		}
+		/* A motion is handled, stop the timer and note the time. */
+		motionheld = 0;
+		settimer(dragtimer, 0);
+		motiontime = nowms();
+		return 1;
+	}
+}
+
+/* This function handles the drawing of the bar.
+ *
+ * While drawing the bar the position where each part of the bar ends is recorded in the monitor's
+ * bar regions, which the buttonpress function uses to work out what the user clicked on. This
+ * way the text does not need to be measured again whenever the bar is clicked.
+ *
+ * The status text can be divided into segments by separating them with control characters, i.e.
+ * characters below the space character such as \x01. The control characters are not drawn and
+ * each segment gets its own region, which makes it possible to tell which part of the status the
+ * user clicked on. E.g.
+ *
+ *    $ xsetroot -name "$(printf 'vol 40%%\x01bat 80%%\x0113:37')"
+ *
+ * gives three segments where a click on "bat 80%" gives a segment index of 1.
+ *
+ * @called from drawbars to update the bars on all monitors
+ * @called from expose if the bar window is exposed (damaged)
+ * @called from propertynotify if the selected client's title changes
+ * @called from restack for convenience
+ * @called from setlayout to update the bar after layout update
+ * @called from updatestatus to update the bar after status update
+ * @calls drw_setscheme to set the next colour scheme
  * @calls drw_text to draw text on the bar
  * @calls drw_rect to draw the client indicator on tags and the floating indicator for the title
  * @calls drw_map to place the finished drawing on the bar window
@@ -2460,7 +3198,7 @@ dirtomon(int dir)
  *    run -> keypress -> focusstack -> restack -> drawbar
  *    run -> keypress -> setlayout -> drawbar
  *    run -> setup -> updatestatus -> drawbar
- *    run -> propertynotify -> drawbars -> drawbar
+ *    run -> clientmessage -> drawbar
  *    run -> propertynotify -> drawbar
  *    run -> propertynotify -> updatestatus -> drawbar
  */
@@ -2472,8 +3210,8 @@ drawbar(Monitor *m)
 	 *    w - holds temporary width values when drawing the bar
 	 *    tw - short for text width, holds the status text width
 	 *    i - common iterator
-	 *    occ - bitmask that holds occupied tags
-	 *    urg - bitmask that holds tags with clients that have the urgent flag set
+	 *    occ - points to the set of occupied tags
+	 *    urg - points to the set of tags with clients that have the urgent flag set
 	 *
 	 * Then we have two variables in relation to the indicator used for occupied tags and for
 	 * floating windows, which is a small square (i.e. a box).
@@ -2488,14 +3226,17 @@ drawbar(Monitor *m)
 	int x, w, tw = 0;
 	int boxs = drw->fonts->h / 9;
 	int boxw = drw->fonts->h / 6 + 2;
-	unsigned int i, occ = 0, urg = 0;
-	Client *c;
+	unsigned int i, len, ns = 0;
+	char buf[sizeof stext], *s;
+	BarRegion *r = m->regions;
+	const Tagset *occ, *urg;
 
 	/* If the bar is not shown then don't spend any effort drawing the bar. As such hiding the
 	 * bar has a positive effect on performance. */
 	if (!m->showbar)
 		return;
 
+	TRACEBEGIN("drawbar");
 	/* Draw status first so it can be overdrawn by tags later. The main reason for this is that
 	 * we want as much of the status shown as possible and it is just easier to draw the status
 	 * first and let other things like tags overwrite it if necessary compared to having to
@@ -2504,51 +3245,65 @@ drawbar(Monitor *m)
 		/* Set the normal colour scheme before drawing the text. This affects the foreground
 		 * and background colour of the status text. */
 		drw_setscheme(drw, scheme[SchemeNorm]);
-		/* Calculate the width of the status text. The TEXTW macro includes lrpad by default
-		 * and we do not want to include that here, we just want to know the size of the
-		 * text. We also do not want the status crammed all the way to the edge of the bar,
-		 * so we add 2 pixels worth of padding that will be added on the right hand side due
-		 * to the position we start drawing the text from. */
-		tw = TEXTW(stext) - lrpad + 2; /* 2px right padding */
-
-		/* The below handles the actual drawing of the status text, the position calculated
-		 * by subtracting the text width from the monitor's window width.
+		/* Make a copy of the status text where the control characters that separate the
+		 * status segments are replaced with string terminators. */
+		for (len = 0; stext[len]; len++)
+			buf[len] = (unsigned char)stext[len] < ' ' ? '\0' : stext[len];
+		buf[len] = '\0';
+
+		/* The status text regions are recorded after the regions for the tags, the layout
+		 * symbol and the window title. */
+		r = m->regions + LENGTH(tags) + 2;
+
+		/* Calculate the width of each status segment as well as the total width. We use
+		 * drw_fontset_getwidth rather than the TEXTW macro as the latter includes lrpad and
+		 * we do not want to include that here, we just want to know the size of the text.
+		 * The widths are held in the region until the segments are drawn. We also do not want
+		 * the status crammed all the way to the edge of the bar, so we add 2 pixels worth of
+		 * padding to the last segment. */
+		for (s = buf; s <= buf + len; s += strlen(s) + 1, ns++)
+			tw += r[ns].x = drw_fontset_getwidth(drw, s);
+		r[ns - 1].x += 2; /* 2px right padding */
+		tw += 2;
+
+		/* The below handles the actual drawing of the status text segments, the position of
+		 * the first segment calculated by subtracting the text width from the monitor's window
+		 * width.
 		 *
 		 * There is more writeup on the drw_text function in drw.c, but since this is the
 		 * first time we this in dwm.c let's have a quick breakdown.
 		 *
 		 *    drw_text(
 		 *       drw,        - the drawable
-		 *       m->ww - tw, - the x position
+		 *       x,          - the x position
 		 *       0,          - the y position
-		 *       tw,         - the width
+		 *       r[i].x,     - the width
 		 *       bh,         - the height
 		 *       0,          - left padding (typically lrpad / 2)
-		 *       stext,      - the text to be drawn
+		 *       s,          - the text to be drawn
 		 *       0           - inverted (swaps foreground and background colours)
 		 *    );
 		 *
 		 * Notable here is the omission of an lrpad value and this has specifically to do
-		 * with that we subtracted that from the text width. Another thing that may not be
+		 * with that we did not include that in the text width. Another thing that may not be
 		 * obvious to someone new to this is that we do not include the monitor position when
 		 * passing the x and y values. This has to do with that the position is relative to
 		 * the bar window and not the bar window's location.
 		 */
-		drw_text(drw, m->ww - tw, 0, tw, bh, 0, stext, 0);
+		for (i = 0, x = m->ww - tw, s = buf; i < ns; i++, s += strlen(s) + 1) {
+			drw_text(drw, x, 0, r[i].x, bh, 0, s, 0);
+			x += r[i].x;
+			r[i].x = x;
+			r[i].click = ClkStatusText;
+			r[i].arg.i = i;
+		}
+		r = m->regions;
 	}
 
-	/* This loops through all clients on the monitor and derives two bitmask variables
-	 * indicating what tags are occupied by clients and what tags are occupied by urgent
-	 * clients. */
-	for (c = m->clients; c; c = c->next) {
-		/* The or-equals operator means the union of occ and c->tags, it is short for
-		 *    occ = occ | c->tags;
-		 */
-		occ |= c->tags;
-		/* We do the same for urgent clients. */
-		if (c->isurgent)
-			urg |= c->tags;
-	}
+	/* These two tag sets indicate what tags are occupied by clients and what tags are occupied
+	 * by urgent clients. Refer to the counttags function. */
+	occ = &m->occ;
+	urg = &m->urg;
 
 	/* This could have been initialised earlier to save on a single line of code, but as it
 	 * stands it clearly indicates that here we start to draw from the beginning of the bar.
@@ -2557,6 +3312,15 @@ drawbar(Monitor *m)
 	x = 0;
 	/* We start by looping through all tags. */
 	for (i = 0; i < LENGTH(tags); i++) {
+		/* With the hidevacant setting only tags that are occupied or viewed are shown. The
+		 * region of a hidden tag is recorded with no width, which means that the
+		 * buttonpress function will never find it. */
+		if (hidevacant && !tagstest(occ, i) && !tagstest(&m->tagset[m->seltags], i)) {
+			r[i].x = x;
+			r[i].click = ClkTagBar;
+			r[i].arg.v = &tagbits[i];
+			continue;
+		}
 		/* The user can define their own tag symbols (or text) so the width of each tag can
 		 * differ from tag to tag. */
 		w = TEXTW(tags[i]);
@@ -2564,11 +3328,9 @@ drawbar(Monitor *m)
 		/* Here we set the colour scheme to use when drawing the tag text. The gist of it is
 		 * that we use SchemeSel if the tag is being viewed and SchemeNorm otherwise.
 		 *
-		 *    m->tagset[m->seltags] - this is the bitmask representing the viewed tags
-		 *    1 << i                - this represents the bitmask for the tag we are
-		 *                            currently processing
-		 *    m->tags... & 1 << i   - the intersection between the two binaries will be true
-		 *                            if the current tag is viewed
+		 *    m->tagset[m->seltags] - this is the set of viewed tags
+		 *    i                     - this is the tag we are currently processing
+		 *    tagstest(...)         - this will be true if the current tag is viewed
 		 *
 		 * After which we end up with either:
 		 *
@@ -2576,45 +3338,47 @@ drawbar(Monitor *m)
 		 * or
 		 *    drw_setscheme(drw, scheme[SchemeNorm]);
 		 */
-		drw_setscheme(drw, scheme[m->tagset[m->seltags] & 1 << i ? SchemeSel : SchemeNorm]);
+		drw_setscheme(drw, scheme[tagstest(&m->tagset[m->seltags], i) ? SchemeSel : SchemeNorm]);
 
 		/* Draw the tag text (tags[i]). Note the last argument which inverts the colours of
 		 * the tag if it is occupied by an urgent client. Invert in this context means to
 		 * swap the foreground and background colours when drawing the text.
 		 *
-		 *    urg          - this is the bitmask representing tags with urgent clients
-		 *    1 << i       - this represents the bitmask for the tag we are currently
-		 *                   processing
-		 *    urg & 1 << i - the intersection between the two binaries will be true if the
-		 *                   current tag has urgent clients
+		 *    urg               - this is the set of tags with urgent clients
+		 *    i                 - this is the tag we are currently processing
+		 *    tagstest(urg, i)  - this will be true if the current tag has urgent clients
 		 */
-		drw_text(drw, x, 0, w, bh, lrpad / 2, tags[i], urg & 1 << i);
+		drw_text(drw, x, 0, w, bh, lrpad / 2, tags[i], tagstest(urg, i));
+		/* Record the region of the tag for the buttonpress function */
+		r[i].x = x + w;
+		r[i].click = ClkTagBar;
+		r[i].arg.v = &tagbits[i];
 
 		/* If the current tag is occupied by clients then draw the small indicator box. */
-		if (occ & 1 << i)
+		if (tagstest(occ, i))
 			/* This draws a rectangle using boxs as an offset on the x and y axis and
 			 * boxw as both the height and width.
 			 *
-			 * The last value urg & 1 << i indicates whether to use the background (1) or
+			 * The last value tagstest(urg, i) indicates whether to use the background (1) or
 			 * foreground (0) colour for the rectangle.
 			 *
 			 * The second to last value indicates whether the rectangle is filled / solid.
 			 *
-			 *    m == selmon && selmon->sel && selmon->sel->tags & 1 << i
+			 *    m == selmon && selmon->sel && tagstest(&selmon->sel->tags, i)
 			 *
 			 * This is a mouthful but what this says is:
 			 *
-			 *    m == selmon &&             - if this is the selected monitor and
-			 *    selmon->sel &&             - that monitor has a selected client and
-			 *    selmon->sel->tags & 1 << i - that client is on the current tag
-			 *                               = then fill the tag
+			 *    m == selmon &&                   - if this is the selected monitor and
+			 *    selmon->sel &&                   - that monitor has a selected client and
+			 *    tagstest(&selmon->sel->tags, i)  - that client is on the current tag
+			 *                                     = then fill the tag
 			 *
 			 * In more simple words you could say that the bar will show a solid box
 			 * indicator for all tags where the currently focused client resides.
 			 */
 			drw_rect(drw, x + boxs, boxs, boxw, boxw,
-				m == selmon && selmon->sel && selmon->sel->tags & 1 << i,
-				urg & 1 << i);
+				m == selmon && selmon->sel && tagstest(&selmon->sel->tags, i),
+				tagstest(urg, i));
 		/* We are done drawing, move our draw "cursor" to the next tag. */
 		x += w;
 	}
@@ -2624,6 +3388,19 @@ drawbar(Monitor *m)
 	/* Just draw the layout symbol. Note how the drw_text function returns how far the cursor
 	 * moved while drawing the text. */
 	x = drw_text(drw, x, 0, w, bh, lrpad / 2, m->ltsymbol, 0);
+	r[i].x = x;
+	r[i].click = ClkLtSymbol;
+	r[i++].arg.i = 0;
+	/* The window title takes up the space between the layout symbol and the status text. If
+	 * the tags and the layout symbol have been drawn over the status text then we make sure
+	 * that the regions still end in increasing order, as the buttonpress function relies on
+	 * that. The parts of the status text that have been drawn over end up with no width. */
+	r[i].x = MAX(x, m->ww - tw);
+	r[i].click = ClkWinTitle;
+	r[i].arg.i = 0;
+	for (len = 1; len <= ns; len++)
+		r[i + len].x = MAX(r[i + len].x, r[i].x);
+	m->nregions = i + 1 + ns;
 
 	/* This checks if there is any space left to draw the window title (while setting w to the
 	 * remaining width at the same time). */
@@ -2634,7 +3411,7 @@ drawbar(Monitor *m)
 			 * monitor. */
 			drw_setscheme(drw, scheme[m == selmon ? SchemeSel : SchemeNorm]);
 			/* Just draw the window title. */
-			drw_text(drw, x, 0, w, bh, lrpad / 2, m->sel->name, 0);
+			drw_text(drw, x, 0, w, bh, lrpad / 2, m->sel->cold->name, 0);
 			/* If the selected client is floating then draw an indicator similar to that
 			 * of tags. This will be a box of the same size and position that always uses
 			 * the foreground colour and will be solid only in the event that the client
@@ -2657,16 +3434,15 @@ drawbar(Monitor *m)
 	}
 	/* Finally place our finished drawing on the bar window by mapping it. */
 	drw_map(drw, m->barwin, 0, 0, m->ww, bh);
+	TRACEEND();
 }
 
 /* This updates the bar on all monitors.
  *
  * @called_from focus to update the bars following focus changes
- * @called_from propertynotify to update the bars following update of window manager hints
  *
  * Internal call stack:
  *    ~ -> focus -> drawbars
- *    run -> propertynotify -> drawbars
  */
 void
 drawbars(void)
@@ -2679,6 +3455,29 @@ drawbars(void)
 		drawbar(m);
 }
 
+/* This draws the outline of where a client would be placed given the position and size, this is
+ * used when moving or resizing a client in wireframe mode.
+ *
+ * The outline is drawn directly on the root window using the wiregc graphics context which XORs
+ * the outline onto what is already on the screen. Drawing the same outline a second time erases
+ * it again. The server is grabbed while the outline is shown so that no other client can draw
+ * over it in the meantime, which would leave artefacts on the screen when the outline is erased.
+ *
+ * The width and height are that of the client window, the outline surrounds the border.
+ *
+ * @called_from movemouse to draw and erase the outline of the new position
+ * @called_from resizemouse to draw and erase the outline of the new size
+ * @calls XDrawRectangle https://tronche.com/gui/x/xlib/graphics/drawing/XDrawRectangle.html
+ *
+ * Internal call stack:
+ *    run -> buttonpress -> movemouse / resizemouse -> drawoutline
+ */
+void
+drawoutline(Client *c, int x, int y, int w, int h)
+{
+	XDrawRectangle(dpy, root, wiregc, x, y, w + 2 * c->bw - 1, h + 2 * c->bw - 1);
+}
+
 /* This handles EnterNotify events coming from the X server.
  *
  * These kind of events can be received when the mouse cursor moves from one window to another,
@@ -2689,11 +3488,12 @@ drawbars(void)
  * enters windows. This is what is referred to as sloppy focus, as opposed to requiring the user to
  * click on windows to select them.
  *
+ * The focus change itself is handled by the hoverfocus function, either straight away or once the
+ * mouse cursor has rested on the window for hoverdelay milliseconds.
+ *
  * @called_from run (the event handler)
- * @calls wintoclient to find the client the event is in relation to (if any)
- * @calls wintomon to find the monitor the event is in relation to if it is not related to a client
- * @calls unfocus to remove focus from the selected client when changing monitors
- * @calls focus to give input focus to a given client or the next in line when changing monitors
+ * @calls hoverfocus to change the selected monitor and client
+ * @calls settimer to start the hover timer if focus changes are delayed
  * @see https://tronche.com/gui/x/xlib/events/window-entry-exit/normal.html
  * @see https://tronche.com/gui/x/xlib/events/window-entry-exit/#XCrossingEvent
  *
@@ -2703,10 +3503,13 @@ drawbars(void)
 void
 enternotify(XEvent *e)
 {
-	Client *c;
-	Monitor *m;
 	XCrossingEvent *ev = &e->xcrossing;
 
+	/* Ignore EnterNotify events that were caused by changes to the stacking order or window
+	 * sizes rather than the user moving the mouse, refer to the restack function. */
+	if (ev->serial < ignoreserial)
+		return;
+
 	/* The event mode can be:
 	 *    - NotifyNormal
 	 *    - NotifyGrab
@@ -2733,30 +3536,18 @@ enternotify(XEvent *e)
 	if ((ev->mode != NotifyNormal || ev->detail == NotifyInferior) && ev->window != root)
 		return;
 
-	/* Find the client this event is for (if any). */
-	c = wintoclient(ev->window);
-
-	/* If the event is in relation to a client then we use the client's monitor. If the event
-	 * is not in relation to a client then call wintomon to work out which monitor this window
-	 * is on. */
-	m = c ? c->mon : wintomon(ev->window);
-
-	/* If the monitor the event is related to is not the selected monitor, then we need to
-	 * change monitor so that the one we found becomes the selected one. */
-	if (m != selmon) {
-		/* Before we change monitor we need to unfocus the selected client on the previous
-		 * monitor and revert input focus to the root window. */
-		unfocus(selmon->sel, 1);
-		/* Setting the selected monitor to be monitor the event is in relation to. */
-		selmon = m;
-	/* If the monitor is the same and the event was not related to a client, or that client
-	 * is the currently selected client, then bail. */
-	} else if (!c || c == selmon->sel)
+	/* If focus is to follow the mouse with a delay (refer to the hoverdelay setting in
+	 * config.def.h) then just remember the window and (re)start the hover timer, which calls
+	 * hovertimeout once the mouse pointer has rested on the window for long enough. Moving
+	 * across many windows in quick succession therefore only results in the last window being
+	 * focused. */
+	if (hoverdelay) {
+		hoverwin = ev->window;
+		settimer(hovertimer, hoverdelay);
 		return;
+	}
 
-	/* Note that c may be NULL here, so this call either focuses on the client the event was
-	 * for, or we give input focus to the last client that had focus on this monitor. */
-	focus(c);
+	hoverfocus(ev->window);
 }
 
 /* This handles Expose events coming from the X server.
@@ -2787,16 +3578,14 @@ enternotify(XEvent *e)
  * and as such status updates stop happening as an example.
  *
  * While the mouse is being moved or resized the respective function checks the event queue for
- * certain events and Expose events are one of the ones checked:
- *
- *     XMaskEvent(dpy, MOUSEMASK|ExposureMask|SubstructureRedirectMask, &ev);
+ * certain events and Expose events are one of the ones checked, refer to the isdragevent function.
  *
  * This means that if an Expose event comes in while a window is being moved around then that will
  * be caught by the movemouse function which will forward the event to this function. This is to
  * ensure that the bar is redrawn if you move a window over the bar and away again.
  *
- * For a better understanding of this try removing ExposureMask| from the XMaskEvent in the
- * movemouse function and move a window over the bar. When the window is moved away then that will
+ * For a better understanding of this try removing the Expose case from the isdragevent
+ * function and move a window over the bar. When the window is moved away then that will
  * leave a blank area where the bar was because the bar is no longer redrawn when these expose
  * events come through.
  *
@@ -2840,12 +3629,11 @@ expose(XEvent *e)
  * If there are no more visible clients then input focus will be reverted to the root window.
  *
  * @called_from buttonpress if the event results in focus going to a different monitor
- * @called_from configurenotify if monitor setup changes
+ * @called_from geomtimeout if monitor setup changes
  * @called_from enternotify to focus on window entered with the mouse cursor
  * @called_from focusmon to focus on the window that last had focus on a monitor
  * @called_from focusstack to focus on the next or previous client in the client list
  * @called_from manage to focus on the newly managed client
- * @called_from motionnotify to focus on the window that last had focus on a monitor
  * @called_from movemouse to give input focus to the client after moving it to another monitor
  * @called_from resizemouse to give input focus to the client after resizing it to another monitor
  * @called_from pop to focus on the client becoming the new master
@@ -2863,9 +3651,11 @@ expose(XEvent *e)
  * @calls seturgent to remove urgency flag if set
  * @calls detachstack to place the client window at the top of the stacking order
  * @calls attachstack to place the client window at the top of the stacking order
+ * @calls resize to give the client its size if the monocle layout is used
  * @calls grabbuttons as we listen for different button presses for a window that has focus
  * @calls setfocus to give the target client input focus
  * @calls drawbars to update the bars on all monitors
+ * @calls settimer to cancel a pending hover focus change
  * @see https://tronche.com/gui/x/xlib/events/input-focus/
  *
  * Internal call stack:
@@ -2876,7 +3666,7 @@ expose(XEvent *e)
  *    run -> buttonpress -> toggletag -> focus
  *    run -> buttonpress -> toggleview -> focus
  *    run -> buttonpress -> view -> focus
- *    run -> configurenotify -> focus
+ *    main -> run -> geomtimeout -> focus
  *    run -> destroynotify / unmapnotify -> unmanage -> focus
  *    run -> enternotify -> focus
  *    run -> keypress -> focusmon -> focus
@@ -2888,13 +3678,20 @@ expose(XEvent *e)
  *    run -> keypress -> toggleview -> focus
  *    run -> keypress -> view -> focus
  *    run -> maprequest -> manage -> focus
- *    run -> motionnotify -> focus
  *    main -> setup -> focus
- *    main -> cleanup -> view -> focus
  */
 void
 focus(Client *c)
 {
+	/* A focus change for any other reason than the mouse cursor resting on a window, e.g. from
+	 * a key binding, takes precedence over the hover. Cancel any pending hover focus change so
+	 * that the hover timer does not move focus back to the hovered window afterwards. The
+	 * hovertimeout function clears hoverwin before focusing, so the hover itself is not
+	 * cancelled here. */
+	if (hoverwin != None) {
+		hoverwin = None;
+		settimer(hovertimer, 0);
+	}
 	/* If the given client is NULL, or it happens to not be visible, then search the first
 	 * visible client in the stacking order list. */
 	if (!c || !ISVISIBLE(c))
@@ -2917,6 +3714,11 @@ focus(Client *c)
 		 * of the stacking order, making it the last window to have received focus. */
 		detachstack(c);
 		attachstack(c);
+		/* The monocle layout only resizes the topmost tiled client in the stack, so a tiled
+		 * client that comes to the top of the stack is given its size here. This does
+		 * nothing if the client already has the right size. Refer to the monocle function. */
+		if (!c->isfloating && c->mon->lt[c->mon->sellt]->arrange == monocle)
+			resize(c, c->mon->wx, c->mon->wy, c->mon->ww - 2 * c->bw, c->mon->wh - 2 * c->bw, 0);
 		/* We grab buttons for the window again as we are listening on less button presses
 		 * for windows that have input focus. */
 		grabbuttons(c, 1);
@@ -2939,6 +3741,7 @@ focus(Client *c)
 	/* Set the selected client to be the one receiving focus, or to NULL in the event that there
 	 * are no visible clients. */
 	selmon->sel = c;
+	selmon->pertag[selmon->curtag].sel = c;
 	/* Finally update the bars on all monitors. This is in case the focus change resulted in the
 	 * selected monitor changing. */
 	drawbars();
@@ -3004,6 +3807,7 @@ focusmon(const Arg *arg)
 /* User function to change focus between visible windows on the selected monitor.
  *
  * @called_from keypress in relation to keybindings
+ * @calls updatevisible to update the array of visible clients
  * @calls focus to give input focus to the next client
  * @calls restack to place the selected client, if floating, above other floating windows
  *
@@ -3013,45 +3817,101 @@ focusmon(const Arg *arg)
 void
 focusstack(const Arg *arg)
 {
-	Client *c = NULL, *i;
+	int i, n;
+	Client *c;
 
 	/* Bail if there is no selected client on the current monitor, or if the selected client is
 	 * fullscreen and we disallow focus to drift from fullscreen windows. */
 	if (!selmon->sel || (selmon->sel->isfullscreen && lockfullscreen))
 		return;
 
-	/* If the input value is positive then we move forward to find the next visible client. */
-	if (arg->i > 0) {
-		/* This searches through the client list for the next visible client. */
-		for (c = selmon->sel->next; c && !ISVISIBLE(c); c = c->next);
-		/* If we have exhausted the list and there are no more visible clients, then we wrap
-		 * around and search for the first visible client in the list. */
-		if (!c)
-			for (c = selmon->clients; c && !ISVISIBLE(c); c = c->next);
-	/* Otherwise we move backward to find the prior visible client. */
-	} else {
-		/* Start from the beginning of the linked list and find the last visible client that
-		 * is not the selected client. */
-		for (i = selmon->clients; i != selmon->sel; i = i->next)
-			if (ISVISIBLE(i))
-				c = i;
-		/* If there are no visible clients prior to the selected one then we simply continue
-		 * where the previous for loop left off and we search for the very last visible
-		 * client. */
-		if (!c)
-			for (; i; i = i->next)
-				if (ISVISIBLE(i))
-					c = i;
-	}
-	/* If we did find a client, and in principle we should as there is at least one visible
-	 * window, then we give input focus to that client. */
-	if (c) {
-		focus(c);
-		/* The explicit restack here is in the event that the client window is floating, or
-		 * we are using the floating layout, in which case we want the selected client to be
-		 * placed above other floating windows. */
-		restack(selmon);
+	/* This makes sure that the array of visible clients is up to date, refer to the
+	 * updatevisible function. The array holds the visible clients in the order of the client
+	 * list, so the next and the previous visible clients are simply the next and previous
+	 * entries in the array. */
+	if (!selmon->visvalid)
+		updatevisible(selmon);
+	for (i = 0; i < selmon->nvis && selmon->vis[i] != selmon->sel; i++);
+	if (i == selmon->nvis)
+		return;
+
+	/* The absolute input value is the number of steps to take, e.g. when key presses have been
+	 * merged by the keypress function. If the input value is positive then we move forward,
+	 * otherwise we move backward, and we wrap around when going past either end of the array. */
+	n = MAX(abs(arg->i), 1) % selmon->nvis;
+	c = selmon->vis[(arg->i > 0 ? i + n : i - n + selmon->nvis) % selmon->nvis];
+
+	/* Then we give input focus to that client. The explicit restack here is in the event that
+	 * the client window is floating, or we are using the floating layout, in which case we want
+	 * the selected client to be placed above other floating windows. */
+	focus(c);
+	restack(selmon);
+}
+
+/* This is called when the geometry timer expires, i.e. when no events relating to changes to the
+ * monitor setup have come in for geomdelay milliseconds. Refer to the configurenotify function.
+ *
+ * @called_from run when the geometry timer expires
+ * @called_from configurenotify and rrnotify if geomdelay is 0
+ * @calls updategeom to update the number of monitors, their sizes and positions
+ * @calls drw_resize to adjust the drawable space
+ * @calls updatebars to create new bar windows in case we have new monitors
+ * @calls resizeclient to restore fullscreen client windows
+ * @calls XMoveResizeWindow https://tronche.com/gui/x/xlib/window/XMoveResizeWindow.html
+ * @calls focus to give back input focus to the last used window as it may have been lost
+ * @calls arrange to resize and reposition tiled clients as the monitor may have changed
+ *
+ * Internal call stack:
+ *    main -> run -> geomtimeout
+ *    run -> configurenotify -> geomtimeout
+ */
+void
+geomtimeout(void)
+{
+	Monitor *m;
+	Client *c;
+	/* Have updategeom run a check to see if we have any new or less monitors and carry on
+	 * regardless if the screen size has changed. */
+	int dirty = updategeom() || sizechanged;
+
+	/* TODO: updategeom handling sucks, needs to be simplified (famous last words) */
+	sizechanged = 0;
+	if (!dirty)
+		return;
+
+	/* This next line changes the screen drawable area. That it resizes the drawable area to be
+	 * the height of the bar is most likely a bug considering that the drawable area is created
+	 * with the dimensions of the screen in the setup function:
+	 *
+	 *    drw = drw_create(dpy, screen, root, sw, sh);
+	 *
+	 * This does not seem to affect the operability of dwm, however, as all that the window
+	 * manager draws is the bar which does not exceed the bar height.
+	 */
+	drw_resize(drw, sw, bh);
+	/* This call to updatebars is to create new bar windows in the event that the call to
+	 * updategeom resulted in new monitors to be created. */
+	updatebars();
+	/* Loop through each monitor to make correction */
+	for (m = mons; m; m = m->next) {
+		/* For every client on the monitor check to see if any of them was in fullscreen and
+		 * if so then resize them to restore fullscreen. */
+		for (c = m->clients; c; c = c->next)
+			if (c->isfullscreen)
+				resizeclient(c, m->mx, m->my, m->mw, m->mh);
+		/* This resizes and repositions the bar according to the new position and size of
+		 * the monitor. */
+		XMoveResizeWindow(dpy, m->barwin, m->wx, m->by, m->ww, bh);
+		/* Likewise for the desktop window, which covers the whole monitor. */
+		XMoveResizeWindow(dpy, m->deskwin, m->mx, m->my, m->mw, m->mh);
 	}
+	/* Give focus back to the last viewed client in case input focus got lost as part of the
+	 * monitor updates. */
+	focus(NULL);
+	/* A final arrange call to resize and reposition tiled clients following the monitor
+	 * changes. Clients on monitors that have not changed already have the right size and
+	 * position, so they are left alone by the layout. */
+	arrange(NULL);
 }
 
 /* This reads a property value of a given atom for a client's window.
@@ -3084,6 +3944,7 @@ getatomprop(Client *c, Atom prop)
 
 	/* This reads the given window property. If the property could be read successfully then
 	 * we enter the if statement, otherwise we end up returning a default atom of None. */
+	TRACEBEGIN("getatomprop");
 	if (XGetWindowProperty(dpy, c->win, prop, 0L, sizeof atom, False, XA_ATOM,
 		&da, &di, &dl, &dl, &p) == Success && p) {
 		/* Capture the value of the prop_return to our local atom which we will return. */
@@ -3091,9 +3952,33 @@ getatomprop(Client *c, Atom prop)
 		/* Free the prop_return variable. */
 		XFree(p);
 	}
+	TRACEEND();
 	return atom;
 }
 
+/* This is a wrapper function that gets the attributes of the given window, which marks the round
+ * trip to the X server in the trace.
+ *
+ * @called_from maprequest to check that the window wants to be managed
+ * @called_from scan to check which existing windows to manage
+ * @calls XGetWindowAttributes https://tronche.com/gui/x/xlib/window-information/XGetWindowAttributes.html
+ * @returns non-zero on success, 0 if the attributes could not be read
+ *
+ * Internal call stack:
+ *    run -> maprequest -> getattributes
+ *    main -> scan -> getattributes
+ */
+int
+getattributes(Window w, XWindowAttributes *wa)
+{
+	int ret;
+
+	TRACEBEGIN("getattributes");
+	ret = XGetWindowAttributes(dpy, w, wa);
+	TRACEEND();
+	return ret;
+}
+
 /* This is a wrapper function that gets the mouse pointer coordinates and stores those in the
  * given x and y pointers.
  *
@@ -3103,7 +3988,7 @@ getatomprop(Client *c, Atom prop)
  *
  * Internal call stack:
  *    run -> buttonpress -> movemouse -> getrootptr
- *    run -> configurenotify -> updategeom -> wintomon -> getrootptr
+ *    main -> run -> geomtimeout -> updategeom -> wintomon -> getrootptr
  *    main -> setup -> updategeom -> wintomon -> getrootptr
  */
 int
@@ -3115,8 +4000,12 @@ getrootptr(int *x, int *y)
 	int di; /* dummy int */
 	unsigned int dui; /* dummy unsigned int */
 	Window dummy;
+	int ret;
 
-	return XQueryPointer(dpy, root, &dummy, &dummy, x, y, &di, &di, &dui);
+	TRACEBEGIN("getrootptr");
+	ret = XQueryPointer(dpy, root, &dummy, &dummy, x, y, &di, &di, &dui);
+	TRACEEND();
+	return ret;
 }
 
 /* This function retrieves the window state for a given window.
@@ -3148,9 +4037,13 @@ getstate(Window w)
 
 	/* This reads the WM_STATE property of a given window. If the property could not be read
 	 * then -1 will be returned. */
+	TRACEBEGIN("getstate");
 	if (XGetWindowProperty(dpy, w, wmatom[WMState], 0L, 2L, False, wmatom[WMState],
-		&real, &format, &n, &extra, (unsigned char **)&p) != Success)
+		&real, &format, &n, &extra, (unsigned char **)&p) != Success) {
+		TRACEEND();
 		return -1;
+	}
+	TRACEEND();
 	/* If the property had a value then set that as the function's return value. */
 	if (n != 0)
 		result = *p;
@@ -3200,8 +4093,12 @@ gettextprop(Window w, Atom atom, char *text, unsigned int size)
 	text[0] = '\0';
 	/* If we could not read the text property, or the text property could be read but contained
 	 * no data, then we exit early indicating that data was not read by returning 0 (false). */
-	if (!XGetTextProperty(dpy, w, &name, atom) || !name.nitems)
+	TRACEBEGIN("gettextprop");
+	if (!XGetTextProperty(dpy, w, &name, atom) || !name.nitems) {
+		TRACEEND();
 		return 0;
+	}
+	TRACEEND();
 
 	/* The property data can either be a text string or it can be a list of text strings. */
 	if (name.encoding == XA_STRING) {
@@ -3222,15 +4119,42 @@ gettextprop(Window w, Atom atom, char *text, unsigned int size)
 	return 1;
 }
 
+/* This is a wrapper function that gets the window that the given window is transient for, which
+ * marks the round trip to the X server in the trace.
+ *
+ * @called_from manage to let transient windows inherit the monitor and tags of their parent
+ * @called_from propertynotify to make a client floating when it becomes transient
+ * @called_from scan to manage transient windows after their parents
+ * @calls XGetTransientForHint https://tronche.com/gui/x/xlib/ICC/client-to-window-manager/XGetTransientForHint.html
+ * @returns non-zero if the window is transient for another window, 0 otherwise
+ *
+ * Internal call stack:
+ *    run -> maprequest -> manage -> gettransient
+ *    run -> propertynotify -> gettransient
+ *    main -> scan -> gettransient
+ */
+int
+gettransient(Window w, Window *trans)
+{
+	int ret;
+
+	TRACEBEGIN("gettransient");
+	ret = XGetTransientForHint(dpy, w, trans);
+	TRACEEND();
+	return ret;
+}
+
 /* This tells the X server what mouse button press scenarios we are interested in receiving
  * notifications for.
  *
+ * The client keeps track of the focus state and the Num Lock modifier generation that its button
+ * grabs were made for, so that grabs are only changed when something has actually changed.
+ *
  * @called_by focus because we subscribe to different button notifications for focused windows
  * @called_by unfocus because we subscribe to different button notifications for unfocused windows
  * @called_by manage to grab buttons in case the client starts on another tag due to client rules
  * @calls XUngrabButton https://tronche.com/gui/x/xlib/input/XUngrabButton.html
  * @calls XGrabButton https://tronche.com/gui/x/xlib/input/XGrabButton.html
- * @calls updatenumlockmask to make sure the Num Lock modifier is correct
  *
  * Internal call stack:
  *    ~ -> focus -> grabbuttons
@@ -3240,79 +4164,95 @@ gettextprop(Window w, Atom atom, char *text, unsigned int size)
 void
 grabbuttons(Client *c, int focused)
 {
-	/* First make sure that we have the right modifier for the Num Lock key */
-	updatenumlockmask();
-	/* Technically there isn't any practical reason why the below is placed within a separate
-	 * block, but it is most likely done so because the function otherwise breaks the general
-	 * pattern of declaring all variables at the start of the function, but here we need to make
-	 * the call to updatenumlockmask() first because we use the numlockmask variable when
-	 * declaring the modifiers array. The alternative could be to place all of the below in a
-	 * separate function but that would be less clean than simply adding it all in a block. */
-	{
-		unsigned int i, j;
-		/* The list of modifiers we are interested in. No additional modifier, the Caps Lock
-		 * mask, the Num Lock mask, and Caps Lock and Num Lock mask together. */
-		unsigned int modifiers[] = { 0, LockMask, numlockmask, numlockmask|LockMask };
-		/* Call to release any buttons we may have grabbed before. */
-		XUngrabButton(dpy, AnyButton, AnyModifier, c->win);
+	unsigned int i, j;
+	/* The list of modifiers we are interested in. No additional modifier, the Caps Lock mask,
+	 * the Num Lock mask, and Caps Lock and Num Lock mask together. */
+	unsigned int modifiers[] = { 0, LockMask, numlockmask, numlockmask|LockMask };
+
+	/* Focus changes happen a lot, and most of the time the client window already has the
+	 * grabs that we need. If the grabs were made for the same focus state and the Num Lock
+	 * modifier has not changed since (refer to the grabgen variable) then there is nothing
+	 * to do. */
+	if (c->grabgen == grabgen && c->grabfocused == focused)
+		return;
 
-		/* If the client is not focused then we are interested in any button press activity
-		 * related to the client window. Only the focus function calls grabbuttons passing
-		 * focused as 1.
-		 */
-		if (!focused)
-			XGrabButton(dpy, AnyButton, AnyModifier, c->win, False,
-				BUTTONMASK, GrabModeSync, GrabModeSync, None, None);
+	/* Otherwise we start over. Note that grabbing or releasing any button with any modifier
+	 * replaces or releases all other button grabs for the window, so the grab for any button
+	 * press activity has to come first and the button bindings have to be grabbed again after
+	 * it, whether the client gains or loses focus.
+	 *
+	 * None of the below waits for a reply from the X server, the requests are sent in one go
+	 * when the output buffer is next flushed. */
+	c->grabgen = grabgen;
+	c->grabfocused = focused;
 
-		/* Loop through all the button bindings as defined in the configuration file and
-		 * look for all bindings related to clicking on a client window (ClkClientWin).
-		 *
-		 * As a practical example let's look at this button binding:
-		 *
-		 *    { ClkClientWin,         MODKEY,         Button1,        movemouse,      {0} },
-		 *
-		 * The binding is for clicking MOD+left mouse button (Button1) on a client window
-		 * to move it around.
-		 *
-		 * To make this happen we need to let the X server know that we want to receive a
-		 * ButtonPress event if the user holds down the modifier key and clicks using the
-		 * left mouse button on the given window. More so we want this to work regardless
-		 * of whether Num Lock or Caps Lock is enabled.
-		 *
-		 * The inner for loop runs through the modifiers that we listed in the modifiers
-		 * array earlier and combines each modifier with the modifier defined in the button
-		 * bindings array.
-		 *
-		 * This will lead to the window manager receiving ButtonPress notifications for this
-		 * window in the following scenarios:
-		 *    - user holds down MODKEY and clicks Button1
-		 *    - user holds down MODKEY and clicks Button1 while Num Lock is on
-		 *    - user holds down MODKEY and clicks Button1 while Lock is on
-		 *    - user holds down MODKEY and clicks Button1 while both Num Lock and Lock is on
-		 */
-		for (i = 0; i < LENGTH(buttons); i++)
-			if (buttons[i].click == ClkClientWin)
-				/* Loop through all the modifiers we are interested in */
-				for (j = 0; j < LENGTH(modifiers); j++)
-					/* Grab the button to tell the X server that we are interested
-					 * in receiving ButtonPress notifications when the user clicks
-					 * on the button in combination with the given modifier. */
-					XGrabButton(dpy, buttons[i].button,
-						buttons[i].mask | modifiers[j],
-						c->win, False, BUTTONMASK,
-						GrabModeAsync, GrabModeSync, None, None);
-	}
+	/* Call to release any buttons we may have grabbed before. */
+	XUngrabButton(dpy, AnyButton, AnyModifier, c->win);
+
+	/* If the client is not focused then we are interested in any button press activity
+	 * related to the client window. Only the focus function calls grabbuttons passing
+	 * focused as 1.
+	 */
+	if (!focused)
+		XGrabButton(dpy, AnyButton, AnyModifier, c->win, False,
+			BUTTONMASK, GrabModeSync, GrabModeSync, None, None);
+
+	/* Loop through all the button bindings as defined in the configuration file and
+	 * look for all bindings related to clicking on a client window (ClkClientWin).
+	 *
+	 * As a practical example let's look at this button binding:
+	 *
+	 *    { ClkClientWin,         MODKEY,         Button1,        movemouse,      {0} },
+	 *
+	 * The binding is for clicking MOD+left mouse button (Button1) on a client window
+	 * to move it around.
+	 *
+	 * To make this happen we need to let the X server know that we want to receive a
+	 * ButtonPress event if the user holds down the modifier key and clicks using the
+	 * left mouse button on the given window. More so we want this to work regardless
+	 * of whether Num Lock or Caps Lock is enabled.
+	 *
+	 * The inner for loop runs through the modifiers that we listed in the modifiers
+	 * array earlier and combines each modifier with the modifier defined in the button
+	 * bindings array.
+	 *
+	 * This will lead to the window manager receiving ButtonPress notifications for this
+	 * window in the following scenarios:
+	 *    - user holds down MODKEY and clicks Button1
+	 *    - user holds down MODKEY and clicks Button1 while Num Lock is on
+	 *    - user holds down MODKEY and clicks Button1 while Lock is on
+	 *    - user holds down MODKEY and clicks Button1 while both Num Lock and Lock is on
+	 */
+	for (i = 0; i < LENGTH(buttons); i++)
+		if (buttons[i].click == ClkClientWin)
+			/* Loop through all the modifiers we are interested in */
+			for (j = 0; j < LENGTH(modifiers); j++)
+				/* Grab the button to tell the X server that we are interested
+				 * in receiving ButtonPress notifications when the user clicks
+				 * on the button in combination with the given modifier. */
+				XGrabButton(dpy, buttons[i].button,
+					buttons[i].mask | modifiers[j],
+					c->win, False, BUTTONMASK,
+					GrabModeAsync, GrabModeSync, None, None);
 }
 
 /* This tells the X server what key press scenarios we are interested in receiving notifications
- * for.
+ * for, and it compiles the key bindings into the key table (keytab) that the keypress function
+ * uses to look up the bindings for a given key.
+ *
+ * The key table is a hash table with open addressing (linear probing) that is keyed on the key
+ * code and the clean modifier mask of the binding. Refer to the keypress function for how it is
+ * used.
  *
  * @called_from mappingnotify in the event of keyboard or keyboard layout change
  * @called_from setup to grab the keys initially
- * @calls XDisplayKeycodes https://tronche.com/gui/x/xlib/input/XDisplayKeycodes.html
  * @calls XUngrabKey https://tronche.com/gui/x/xlib/input/XUngrabKey.html
- * @calls XGetKeyboardMapping https://tronche.com/gui/x/xlib/input/XGetKeyboardMapping.html
+ * @calls XkbGetMap https://www.x.org/releases/current/doc/libX11/XKB/xkblib.html
+ * @calls XkbFreeKeyboard https://www.x.org/releases/current/doc/libX11/XKB/xkblib.html
  * @calls XGrabKey https://tronche.com/gui/x/xlib/input/XGrabKey.html
+ * @calls qsort to sort the key codes by keysym
+ * @calls keyhash to find the position of a binding in the key table
+ * @calls ecalloc to allocate the key table
  * @calls updatenumlockmask
  * @see https://tronche.com/gui/x/xlib/utilities/keyboard/
  *
@@ -3332,20 +4272,18 @@ grabkeys(void)
 	 * declaring the modifiers array. The alternative could be to place all of the below in a
 	 * separate function but that would be less clean than simply adding it all in a block. */
 	{
-		unsigned int i, j, k;
+		unsigned int i, j, k, n, h, lo, hi, mod, grab, pass, count;
 		/* The list of modifiers we are interested in. No additional modifier, the Lock mask,
 		 * the Num Lock mask, and Lock and Num Lock mask together. */
 		unsigned int modifiers[] = { 0, LockMask, numlockmask, numlockmask|LockMask };
-		int start, end, skip;
-		KeySym *syms;
+		XkbDescPtr xkb;
+		KeySymCode *codes;
 
 		/* Call to release any keys we may have grabbed before. */
 		XUngrabKey(dpy, AnyKey, AnyModifier, root);
 
 		/* It is not uncommon for a keysym to map to multiple keycodes. Here we make a call to
-		 * XDisplayKeycodes to get the number of keycodes that are supported by the specific
-		 * display, then we call XGetKeyboardMapping to get all the keysym for all key code within
-		 * the given range.
+		 * XkbGetMap to get the keysyms for all key codes in the current keyboard mapping.
 		 *
 		 * The reasoning here is that if we have a keybinding for, say, XF86AudioPlay then we want
 		 * to subscribe to all key press events for all codes that XF86AudioPlay maps to.
@@ -3360,18 +4298,40 @@ grabkeys(void)
 		 * Here the keyboard may be sending the keycode of 172 while a pair of headphones may be
 		 * sending through the keycode of 215. In order for both the keyboard and headphones to
 		 * work we need to grab both keys when going through and setting up keybindings.
+		 *
+		 * In the unlikely event that the keyboard mapping can't be retrieved then xkb will be
+		 * NULL. This is a scenario that is unlikely to happen in practice and the code is
+		 * primarily just a precaution.
 		 */
-		XDisplayKeycodes(dpy, &start, &end);
-		/* This may not be immediately obvious, but the skip variable here will hold the number of
-		 * keysyms per key code. This is later used to know how many items to skip when looking up
-		 * keysyms for a given key code, hence the variable name of "skip". */
-		syms = XGetKeyboardMapping(dpy, start, end - start + 1, &skip);
-		/* In the unlikely event that XGetKeyboardMapping can't allocate memory to hold the
-		 * returned syms then syms will be NULL. This is a scenario that is unlikely to happen in
-		 * practice and the code is primarily just a precaution. */
-		if (!syms)
+		TRACEBEGIN("XkbGetMap");
+		xkb = XkbGetMap(dpy, XkbKeySymsMask, XkbUseCoreKbd);
+		TRACEEND();
+		if (!xkb)
 			return;
 
+		/* Collect the first keysym of the first group of each key code. Note that we only match
+		 * on the very first keysym for a key (not all keysyms for all keys).
+		 *
+		 * This has to do with how dwm intentionally only supports top level keysyms as due to
+		 * how modifier keys are handled, e.g. XK_colon is not supported but XK_semicolon is.
+		 *
+		 *    $ xmodmap -pke | grep colon
+		 *    keycode  47 = semicolon colon semicolon colon dead_acute dead_doubleacute
+		 *                  dead_acute
+		 *
+		 * The key codes are then sorted by keysym so that all the key codes for the keysym of a
+		 * binding can be found with a binary search rather than by going through every key code
+		 * for every binding.
+		 */
+		codes = ecalloc(xkb->max_key_code - xkb->min_key_code + 1, sizeof(KeySymCode));
+		for (n = 0, k = xkb->min_key_code; k <= xkb->max_key_code; k++)
+			if (XkbKeyNumSyms(xkb, k)) {
+				codes[n].keysym = XkbKeySymEntry(xkb, k, 0, 0);
+				codes[n++].keycode = k;
+			}
+		XkbFreeKeyboard(xkb, 0, True);
+		qsort(codes, n, sizeof(KeySymCode), keysymcodecmp);
+
 		/* Loop through all the key bindings as defined in the configuration file.
 		 *
 		 * As a practical example let's look at this key binding:
@@ -3408,34 +4368,231 @@ grabkeys(void)
 		 *
 		 * but it will not work, however, due to how the logic in the keypress function
 		 * handles modifiers, key codes and keysyms.
+		 *
+		 * The bindings are added to the key table in the order that they are listed in the
+		 * keys array. Bindings for the same key code and modifier end up further along the same
+		 * probe sequence, which means that the keypress function will find and call them in
+		 * the same order. A key code and modifier combination only needs to be grabbed once,
+		 * regardless of how many bindings there are for it.
+		 *
+		 * This is done in two passes. The first pass only counts the number of entries, which is
+		 * the number of bindings plus the additional key codes for keysyms that map to more than
+		 * one key code. The key table is then sized to be at least twice the number of entries
+		 * so that it never gets more than half full, which keeps the probe sequences short.
 		 */
-		for (k = start; k <= end; k++)
-			for (i = 0; i < LENGTH(keys); i++)
-				/* Check that the keysym listed in the keys array matches the key. The skip
-				 * variable holds the number of keysyms per key code, so we multiply that to
-				 * find the first keysym for a given key code. Note that we only match on the
-				 * very first keysym for a key (not all keysyms for all keys).
-				 *
-				 * This has to do with how dwm intentionally only supports top level keysyms as
-				 * due to how modifier keys are handled, e.g. XK_colon is not supported but
-				 * XK_semicolon is.
-				 *
-				 *    $ xmodmap -pke | grep colon
-				 *    keycode  47 = semicolon colon semicolon colon dead_acute dead_doubleacute
-				 *                  dead_acute
-				 */
-				if (keys[i].keysym == syms[(k - start) * skip])
+		for (pass = 0, count = 0; pass < 2; pass++) {
+			if (pass) {
+				free(keytab);
+				for (keytabsize = 16; keytabsize < 2 * count; keytabsize *= 2);
+				keytab = ecalloc(keytabsize, sizeof(KeySlot));
+			}
+			for (i = 0; i < LENGTH(keys); i++) {
+				/* Binary search for the first key code that has the keysym of the binding */
+				for (lo = 0, hi = n; lo < hi;) {
+					h = (lo + hi) / 2;
+					if (codes[h].keysym < keys[i].keysym)
+						lo = h + 1;
+					else
+						hi = h;
+				}
+				mod = CLEANMASK(keys[i].mod);
+				for (; lo < n && codes[lo].keysym == keys[i].keysym; lo++) {
+					if (!pass) {
+						count++;
+						continue;
+					}
+					grab = 1;
+					/* Find the next free slot in the key table, noting whether the key
+					 * code and modifier combination has been added (grabbed) before. */
+					h = keyhash(codes[lo].keycode, mod);
+					for (; keytab[h].key; h = (h + 1) & (keytabsize - 1))
+						if (keytab[h].keycode == codes[lo].keycode && keytab[h].mod == mod)
+							grab = 0;
+					keytab[h].keycode = codes[lo].keycode;
+					keytab[h].mod = mod;
+					keytab[h].key = &keys[i];
+					if (!grab)
+						continue;
 					/* Loop through all the modifiers we are interested in */
 					for (j = 0; j < LENGTH(modifiers); j++)
-						/* Grab the key to tell the X server that we are interested
-						 * in receiving KeyPress notifications when the user clicks
-						 * on the key in combination with the given modifier. */
-						XGrabKey(dpy, k,
+						/* Grab the key to tell the X server that we are interested in
+						 * receiving KeyPress notifications when the user clicks on the key
+						 * in combination with the given modifier. */
+						XGrabKey(dpy, codes[lo].keycode,
 							keys[i].mod | modifiers[j],
 							root, True,
 							GrabModeAsync, GrabModeAsync);
-		XFree(syms);
+				}
+			}
+		}
+		free(codes);
+	}
+}
+
+/* This is a wrapper function that grabs the mouse pointer for moving or resizing a window with
+ * the given cursor, which marks the round trip to the X server in the trace.
+ *
+ * We grab the mouse pointer to tell the X server that we are interested in receiving events
+ * related to the mouse, in particular MotionNotify events, and the cursor indicates the kind of
+ * operation that is being performed.
+ *
+ * @called_from movemouse to start moving a window
+ * @called_from resizemouse to start resizing a window
+ * @calls XGrabPointer https://tronche.com/gui/x/xlib/input/XGrabPointer.html
+ * @returns 1 if the pointer was grabbed, 0 otherwise
+ *
+ * Internal call stack:
+ *    run -> buttonpress -> movemouse / resizemouse -> grabpointer
+ */
+int
+grabpointer(int cur)
+{
+	int ret;
+
+	TRACEBEGIN("XGrabPointer");
+	ret = XGrabPointer(dpy, root, False, MOUSEMASK, GrabModeAsync, GrabModeAsync,
+		None, cursor[cur]->cursor, CurrentTime) == GrabSuccess;
+	TRACEEND();
+	return ret;
+}
+
+#ifdef STATS
+/* This records a value in a histogram.
+ *
+ * The bucket for the value is found from the position of the highest set bit (the power of two)
+ * and the HISTBITS bits that follow it (the sub-bucket). For example with HISTBITS being 2 the
+ * values 4 through 7 have a bucket each, 8 and 9 share a bucket, 10 and 11 share the next, and so
+ * on. Refer to the Hist struct.
+ *
+ * @called_from run to record how long event handlers take and how many events were read
+ * @called_from keypress and buttonpress to record how long bound functions take
+ *
+ * Internal call stack:
+ *    main -> run -> histadd
+ *    run -> keypress / buttonpress -> histadd
+ */
+void
+histadd(Hist *h, unsigned long v)
+{
+	unsigned int e, i;
+
+	if (v < HISTSUB)
+		i = v;
+	else {
+		for (e = HISTBITS; e < HISTLEN / HISTSUB + HISTBITS && v >> (e + 1); e++);
+		i = MIN((e - HISTBITS + 1) * HISTSUB + ((v >> (e - HISTBITS)) & (HISTSUB - 1)),
+			HISTLEN - 1);
+	}
+	h->buckets[i]++;
+	h->count++;
+	h->sum += v;
+	h->max = MAX(h->max, v);
+}
+
+/* This writes a histogram in the Prometheus text format, i.e. as a series of cumulative buckets
+ * followed by the sum and the count of the recorded values.
+ *
+ * The upper bound of each bucket is multiplied by the given scale, e.g. to report nanoseconds as
+ * seconds. Buckets above the highest bucket that has any values are left out, and the last bucket
+ * (which has no upper bound) is only reported as part of the +Inf bucket.
+ *
+ * @called_from statswrite to write each histogram
+ * @calls fprintf https://man7.org/linux/man-pages/man3/fprintf.3.html
+ * @see https://prometheus.io/docs/instrumenting/exposition_formats/
+ *
+ * Internal call stack:
+ *    ~ -> statswrite -> histwrite
+ */
+void
+histwrite(FILE *f, const char *name, const char *labels, const Hist *h, double scale)
+{
+	unsigned int i, last;
+	unsigned long n, upper;
+	const char *sep = *labels ? "," : "";
+
+	for (last = HISTLEN - 1; last && !h->buckets[last - 1]; last--);
+	for (i = 0, n = 0; i < last; i++) {
+		n += h->buckets[i];
+		upper = i < HISTSUB ? i : ((HISTSUB + i % HISTSUB + 1UL) << (i / HISTSUB - 1)) - 1;
+		fprintf(f, "%s_bucket{%s%sle=\"%.9g\"} %lu\n", name, labels, sep, upper * scale, n);
 	}
+	fprintf(f, "%s_bucket{%s%sle=\"+Inf\"} %lu\n", name, labels, sep, h->count);
+	fprintf(f, "%s_sum%s%s%s %.9g\n", name, *sep ? "{" : "", labels, *sep ? "}" : "",
+		h->sum * scale);
+	fprintf(f, "%s_count%s%s%s %lu\n", name, *sep ? "{" : "", labels, *sep ? "}" : "", h->count);
+}
+#endif /* STATS */
+
+/* This changes the selected monitor and gives input focus to the client for the window that the
+ * mouse cursor entered, refer to the enternotify function.
+ *
+ * @called_from enternotify when focus follows the mouse immediately
+ * @called_from hovertimeout when the mouse cursor has rested on the window
+ * @calls wintoclient to find the client the window is in relation to (if any)
+ * @calls wintomon to find the monitor the window is on if it is not related to a client
+ * @calls unfocus to remove focus from the selected client when changing monitors
+ * @calls focus to give input focus to a given client or the next in line when changing monitors
+ *
+ * Internal call stack:
+ *    run -> enternotify -> hoverfocus
+ *    run -> hovertimeout -> hoverfocus
+ */
+void
+hoverfocus(Window w)
+{
+	Client *c;
+	Monitor *m;
+
+	/* Find the client this window belongs to (if any). */
+	c = wintoclient(w);
+
+	/* If the window is in relation to a client then we use the client's monitor. If the window
+	 * is not in relation to a client then call wintomon to work out which monitor this window
+	 * is on. */
+	m = c ? c->mon : wintomon(w);
+
+	/* If the monitor the window is related to is not the selected monitor, then we need to
+	 * change monitor so that the one we found becomes the selected one. */
+	if (m != selmon) {
+		/* Before we change monitor we need to unfocus the selected client on the previous
+		 * monitor and revert input focus to the root window. */
+		unfocus(selmon->sel, 1);
+		/* Setting the selected monitor to be monitor the window is in relation to. */
+		selmon = m;
+	/* If the monitor is the same and the window was not related to a client, or that client
+	 * is the currently selected client, then bail. */
+	} else if (!c || c == selmon->sel)
+		return;
+
+	/* Note that c may be NULL here, so this call either focuses on the client the window
+	 * belongs to, or we give input focus to the last client that had focus on this monitor. */
+	focus(c);
+}
+
+/* This is called when the hover timer expires, i.e. when the mouse cursor has rested on the
+ * window that it last entered for hoverdelay milliseconds.
+ *
+ * The window may have been destroyed in the meantime, in which case wintoclient will not find a
+ * client for it and wintomon returns the selected monitor, so hoverfocus does nothing. The focus
+ * then stays as it is until the mouse cursor enters another window.
+ *
+ * @called_from run when the hover timer expires
+ * @calls hoverfocus to focus the window that the mouse cursor rests on
+ *
+ * Internal call stack:
+ *    main -> run -> hovertimeout
+ */
+void
+hovertimeout(void)
+{
+	Window w = hoverwin;
+
+	/* The hover timer may have been cancelled by a mouse click or by a focus change, refer to
+	 * the buttonpress and focus functions. */
+	if (w == None)
+		return;
+	hoverwin = None;
+	hoverfocus(w);
 }
 
 /* User function to increment or decrement the number of client windows in the master area.
@@ -3454,12 +4611,68 @@ incnmaster(const Arg *arg)
 	/* This adjusts the number of master (nmaster) clients with the given argument. The
 	 * MAX(..., 0) is just a safeguard to prevent the nmaster value from becoming negative. */
 	selmon->nmaster = MAX(selmon->nmaster + arg->i, 0);
+	selmon->pertag[selmon->curtag].nmaster = selmon->nmaster;
 	/* A full arrange to resize and reposition clients accordingly. In principle this could have
 	 * been an arrangemon call as we do not need to bring new clients into view, apply a restack
 	 * or to update the bar. */
 	arrange(selmon);
 }
 
+/* This is the predicate function used with XCheckIfEvent in the dragevent function to pick out
+ * the events that the movemouse and resizemouse functions handle while a window is dragged, which
+ * are mouse events, the events that are forwarded to their event handlers, and XSync alarm
+ * events. Alarm events are extension events which can not be selected using an event mask.
+ *
+ * @called_from XCheckIfEvent via dragevent
+ * @called_from ismotionhead to find where the MotionNotify events at the head of the queue end
+ * @returns True if the event is of interest, False otherwise
+ *
+ * Internal call stack:
+ *    run -> buttonpress -> movemouse / resizemouse -> dragevent -> XCheckIfEvent -> isdragevent
+ */
+Bool
+isdragevent(Display *dpy, XEvent *ev, XPointer arg)
+{
+	switch (ev->type) {
+	case ButtonPress:
+	case ButtonRelease:
+	case MotionNotify:
+	case ConfigureRequest:
+	case Expose:
+	case MapRequest:
+		return True;
+	}
+	return havesync && ev->type == syncevbase + XSyncAlarmNotify;
+}
+
+/* This is the predicate function used with XCheckIfEvent in the dragevent function to skip ahead
+ * to the latest MotionNotify event at the head of the event queue.
+ *
+ * Only MotionNotify events that come before any other event handled by the drag loops are
+ * accepted. Once such an event is seen the stop flag pointed to by the argument is set and no
+ * further MotionNotify events are accepted, as skipping past for example a ButtonRelease or a
+ * ConfigureRequest event would handle the motion out of order. Events that the drag loops do not
+ * handle are left in the queue for the event loop and do not stop the search.
+ *
+ * @called_from XCheckIfEvent via dragevent
+ * @calls isdragevent to tell whether an event is handled by the drag loops
+ * @returns True if the event is a MotionNotify event at the head of the queue, False otherwise
+ *
+ * Internal call stack:
+ *    run -> buttonpress -> movemouse / resizemouse -> dragevent -> XCheckIfEvent -> ismotionhead
+ */
+Bool
+ismotionhead(Display *dpy, XEvent *ev, XPointer arg)
+{
+	int *stop = (int *)arg;
+
+	if (*stop || ev->type != MotionNotify) {
+		*stop |= isdragevent(dpy, ev, NULL);
+		return False;
+	}
+	return True;
+}
+
 #ifdef XINERAMA
 /* Xinerama can give multiple geometries when querying for screens and we only want to consider
  * unique geometries as separate monitors. This helper function is used by the updategeom function
@@ -3469,7 +4682,7 @@ incnmaster(const Arg *arg)
  * @called_by updategeom to de-duplicate geometries returned by XineramaQueryScreens
  *
  * Internal call stack:
- *    run -> configurenotify -> updategeom -> isuniquegeom
+ *    main -> run -> geomtimeout -> updategeom -> isuniquegeom
  *    main -> setup -> updategeom -> isuniquegeom
  */
 static int
@@ -3488,10 +4701,63 @@ isuniquegeom(XineramaScreenInfo *unique, size_t n, XineramaScreenInfo *info)
 }
 #endif /* XINERAMA */
 
+/* This returns the position in the key table (keytab) where the search for the bindings for the
+ * given key code and modifier starts. Refer to the grabkeys function for how the key table is
+ * populated and to the keypress function for how it is used.
+ *
+ * The key codes are in the range 8-255 and there are only eight modifier bits, so a simple
+ * multiplicative hash of the two combined is enough to spread the bindings over the table.
+ *
+ * @called_from grabkeys to add bindings to the key table
+ * @called_from keypress to look up the bindings for a key press
+ *
+ * Internal call stack:
+ *    run -> keypress -> keyhash
+ *    run -> mappingnotify -> grabkeys -> keyhash
+ *    main -> setup -> grabkeys -> keyhash
+ */
+unsigned int
+keyhash(unsigned int keycode, unsigned int mod)
+{
+	return ((keycode << 8 | mod) * 2654435761u >> 8) & (keytabsize - 1);
+}
+
 /* This handles KeyPress events coming from the X server.
+ *
+ * The bindings for the key that was pressed are looked up in the key table (keytab) that the
+ * grabkeys function compiled from the keys array. The key table is keyed on the key code and
+ * the clean modifier mask, so rather than translating the key code to a keysym and comparing
+ * that against every key binding we only need to go through the handful of slots that follow
+ * the position given by keyhash until an empty slot is found.
+ *
+ * As a demonstration let's run the xev (event tester) tool and press the "d" key on the
+ * keyboard. The output of xev should say something along the lines of:
+ *
+ *    KeyPress event, serial 35, synthetic NO, window 0x8400001,
+ *    root 0x6be, subw 0x0, time 29383033, (56,550), root:(5618,835),
+ *    state 0x0, keycode 40 (keysym 0x64, d), same_screen YES,
+ *    XLookupString gives 1 bytes: (64) "d"
+ *    XmbLookupString gives 1 bytes: (64) "d"
+ *    XFilterEvent returns: False
+ *
+ * The XKeyEvent key code (ev->keycode) in this scenario would have the value of 40 as shown in
+ * the output above, and the grabkeys function will have added any bindings for XK_d (the top
+ * level keysym for that key code) to the key table under key code 40.
+ *
+ * For simplicity dwm only supports keybindings using top level keybindings. As such keybindings
+ * involving the shift key will be including the ShiftMask in the modifier key rather than using
+ * second level keysyms for the key. E.g.
+ *
+ *    { MODKEY|ShiftMask,             XK_c,      killclient,     {0} },
+ *
+ * Removing the ShiftMask and adding XK_C as the key will not work due to how the ShiftMask is
+ * taken into account when comparing the modifier and the event state.
+ *
+ * Queued up auto-repeated key presses for bindings that are marked as accumulating in the
+ * configuration file are merged into a single call, refer to the comments in the function body.
  *
  * @called_from run (the event handler)
- * @calls XKeycodeToKeysym https://tronche.com/gui/x/xlib/utilities/keyboard/XKeycodeToKeysym.html
+ * @calls keyhash to find the bindings for the key in the key table
  * @calls functions as defined in the keys array
  * @see grabkeys for how the window manager subscribes to key presses
  *
@@ -3501,75 +4767,114 @@ isuniquegeom(XineramaScreenInfo *unique, size_t n, XineramaScreenInfo *info)
 void
 keypress(XEvent *e)
 {
-	unsigned int i;
-	KeySym keysym;
+	unsigned int h, i, mod, acc;
+	int n;
+	Arg arg;
+	const Key *key;
 	XKeyEvent *ev;
+#ifdef STATS
+	unsigned long t;
+#endif /* STATS */
+
+	/* The key table will not exist if the keyboard mapping could not be retrieved */
+	if (!keytab)
+		return;
 
 	ev = &e->xkey;
 
-	/* The XKeycodeToKeysym function uses internal Xlib tables and returns the keysym defined
-	 * for the given key code. The last argument of 0 is for the index of the key code vector
-	 * which means that we are only interested in top level keysyms.
-	 *
-	 * As a demonstration let's run the xev (event tester) tool and press the "d" key on the
-	 * keyboard. The output of xev should say something along the lines of:
-	 *
-	 *    KeyPress event, serial 35, synthetic NO, window 0x8400001,
-	 *    root 0x6be, subw 0x0, time 29383033, (56,550), root:(5618,835),
-	 *    state 0x0, keycode 40 (keysym 0x64, d), same_screen YES,
-	 *    XLookupString gives 1 bytes: (64) "d"
-	 *    XmbLookupString gives 1 bytes: (64) "d"
-	 *    XFilterEvent returns: False
-	 *
-	 * The XKeyEvent key code (ev->keycode) in this scenario would have the value of 40 as
-	 * shown shown in the output above. The keysym returned by the XKeycodeToKeysym function
-	 * would have the decimal value of 100 (hexadecimal 0x64) which is XK_d because we
-	 * specifically asked for the top level symbolic key. If we had passed 1 to get the second
-	 * level keys then the keysym returned would be decimal 68 (hexadecimal 0x44) which is XK_D.
-	 *
-	 * For simplicity dwm only supports keybindings using top level keybindings. As such
-	 * keybindings involving the shift key will be including the ShiftMask in the modifier key
-	 * rather than using second level keysyms for the key. E.g.
-	 *
-	 *    { MODKEY|ShiftMask,             XK_c,      killclient,     {0} },
-	 *
-	 * Removing the ShiftMask and adding XK_C as the key will not work due to how the ShiftMask
-	 * is taken into account when comparing the modifier and the event state.
-	 */
-	keysym = XKeycodeToKeysym(dpy, (KeyCode)ev->keycode, 0);
-	/* Loop through each keybinding */
-	for (i = 0; i < LENGTH(keys); i++)
-		/* Let's break down the matching process here with an example.
-		 *
-		 *      modifier                      key        function        argument
-		 *    { MODKEY,                       XK_i,      incnmaster,     {.i = +1 } },
-		 *
-		 * This checks that the keysym, e.g. XK_i, matches:
-		 *    keysym == keys[i].keysym
-		 *
-		 * This checks that the modifier matches:
-		 *    && CLEANMASK(keys[i].mod) == CLEANMASK(ev->state)
-		 *
-		 * Keybindings that do not have a function are simply ignored:
-		 *    && keys[i].func
-		 *
-		 * It is worth noting that the CLEANMASK macro removes Num Lock and Caps Lock mask
-		 * from the modifier as well as the event state. This has to do with that we want
-		 * these keybindings to work regardless of whether Num Lock and/or Caps Lock is
-		 * enabled or not. See the grabkeys function for how we subscribe to all of the key
-		 * combinations to cover this.
-		 */
-		if (keysym == keys[i].keysym
-		&& CLEANMASK(keys[i].mod) == CLEANMASK(ev->state)
-		&& keys[i].func)
-			/* This calls the function associated with the keybinding with the given
-			 * argument, e.g. calling incnmaster with the +1 argument. */
-			keys[i].func(&(keys[i].arg));
-			/* Note that there is no break; following this, which means that we will
-			 * continue searching through the key bindings for more matches. As such
-			 * it is possible to have more than one thing happen when a key combination
-			 * is pressed by having the same keybinding multiple times referring to
-			 * different functions. */
+	/* It is worth noting that the CLEANMASK macro removes Num Lock and Caps Lock mask from the
+	 * event state. This has to do with that we want keybindings to work regardless of whether
+	 * Num Lock and/or Caps Lock is enabled or not. The modifiers of the bindings in the key table
+	 * have already been cleaned the same way. */
+	mod = CLEANMASK(ev->state);
+	/* Go through the slots until we hit an empty one. Other keys may share the same slots, so
+	 * we need to check that the key code and the modifier matches.
+	 *
+	 * Keybindings that do not have a function are simply ignored.
+	 *
+	 * This first pass only checks whether all the bindings for the key are accumulating (as
+	 * listed in the accumulating array in the configuration file). */
+	for (h = keyhash(ev->keycode, mod), acc = 0; keytab[h].key; h = (h + 1) & (keytabsize - 1)) {
+		key = keytab[h].key;
+		if (keytab[h].keycode != ev->keycode || keytab[h].mod != mod || !key->func)
+			continue;
+		for (i = 0; i < LENGTH(accumulating) && accumulating[i] != key->func; i++);
+		if (!(acc = i < LENGTH(accumulating)))
+			break;
+	}
+
+	/* If they are, then we look for repeats of this key press that are waiting in the local
+	 * event queue of the run function. Holding down a key makes the keyboard auto-repeat
+	 * generate key presses at a steady rate, and if handling them takes longer than that (e.g.
+	 * due to arranging many clients) then they start to queue up. Rather than handling each
+	 * of them in turn we drop them and call the binding once, with the argument multiplied by
+	 * the number of key presses.
+	 *
+	 * The events that come before this one in the queue have already been handled, so the
+	 * first input event in the queue is the one that follows this one. As auto-repeat is
+	 * detectable (refer to the setup function) a held down key results in key presses without
+	 * a key release in between, so we count key presses with the same key code and state and
+	 * stop at the first other input event. */
+	for (n = 1, i = 0; acc && i < (unsigned int)evqlen; i++) {
+		if (!evq[i].type || !ISINPUT(evq[i].type))
+			continue;
+		if (evq[i].type != KeyPress || evq[i].xkey.keycode != ev->keycode
+		|| evq[i].xkey.state != ev->state)
+			break;
+		evq[i].type = 0;
+		n++;
+	}
+
+	/* This second pass calls the functions of the bindings. */
+	for (h = keyhash(ev->keycode, mod); keytab[h].key; h = (h + 1) & (keytabsize - 1)) {
+		key = keytab[h].key;
+		if (keytab[h].keycode != ev->keycode || keytab[h].mod != mod || !key->func)
+			continue;
+		/* This calls the function associated with the keybinding with the given argument,
+		 * e.g. calling incnmaster with the +1 argument. For key presses that were merged the
+		 * argument is multiplied by the number of key presses, e.g. calling incnmaster with
+		 * +3 instead. Note that setmfact takes a float argument and values of 1.0 and above
+		 * set the factor absolutely rather than adjusting it, so these are left as-is. */
+#ifdef STATS
+		t = statsnow();
+#endif /* STATS */
+		if (n > 1) {
+			arg = key->arg;
+			if (key->func == setmfact) {
+				if (arg.f < 1.0)
+					arg.f *= n;
+			} else
+				arg.i *= n;
+			key->func(&arg);
+		} else
+			key->func(&(key->arg));
+#ifdef STATS
+		histadd(&keystats[key - keys], statsnow() - t);
+#endif /* STATS */
+		/* Note that there is no break; following this, which means that we will continue
+		 * searching through the key table for more matches. As such it is possible to have
+		 * more than one thing happen when a key combination is pressed by having the same
+		 * keybinding multiple times referring to different functions. These are called in the
+		 * order they are listed in the keys array. */
+	}
+}
+
+/* This is the comparison function used with qsort when the grabkeys function sorts the key codes
+ * by keysym. Key codes that have the same keysym are kept in key code order.
+ *
+ * @called_from qsort as called from grabkeys
+ *
+ * Internal call stack:
+ *    main -> setup -> grabkeys -> qsort -> keysymcodecmp
+ */
+int
+keysymcodecmp(const void *a, const void *b)
+{
+	const KeySymCode *x = a, *y = b;
+
+	if (x->keysym != y->keysym)
+		return x->keysym < y->keysym ? -1 : 1;
+	return x->keycode - y->keycode;
 }
 
 /* User function to close the selected client,
@@ -3625,7 +4930,9 @@ killclient(const Arg *arg)
 		XKillClient(dpy, selmon->sel->win);
 		/* This flushes the output buffer and then waits until all requests have been
 		 * received and processed by the X server. */
+		TRACEBEGIN("XSync");
 		XSync(dpy, False);
+		TRACEEND();
 		/* Revert to the normal X error handler */
 		XSetErrorHandler(xerror);
 		/* This restarts processing of requests and close downs on other connections */
@@ -3640,12 +4947,12 @@ killclient(const Arg *arg)
  *
  * @called_from maprequest to manage new clients
  * @called_from scan to manage existing windows
- * @calls XGetTransientForHint https://tronche.com/gui/x/xlib/ICC/client-to-window-manager/XGetTransientForHint.html
+ * @calls gettransient to check whether the window is transient for another window
  * @calls XConfigureWindow https://tronche.com/gui/x/xlib/window/XConfigureWindow.html
  * @calls XSetWindowBorder https://tronche.com/gui/x/xlib/window/XSetWindowBorder.html
  * @calls XSelectInput https://tronche.com/gui/x/xlib/event-handling/XSelectInput.html
  * @calls XRaiseWindow https://tronche.com/gui/x/xlib/window/XRaiseWindow.html
- * @calls ecalloc to allocate space for the new client (see util.c)
+ * @calls poolalloc to allocate space for the new client (see util.c)
  * @calls updatetitle to read and store the client's window title
  * @calls wintoclient to find the parent client for a transient window
  * @calls applyrules to search for and to apply client rules that matches the client window
@@ -3675,20 +4982,22 @@ manage(Window w, XWindowAttributes *wa)
 	Window trans = None;
 	XWindowChanges wc;
 
+	TRACEBEGIN("manage");
 	/* Allocate memory for the new client. */
-	c = ecalloc(1, sizeof(Client));
+	c = poolalloc(&clientpool);
+	c->cold = poolalloc(&coldpool);
 	/* Keep a reference to the window this client represents. This is used in many places. */
 	c->win = w;
 	/* Here we initially use the original position and size of the window as defined by the
 	 * window attributes. Setting the old variables here are mostly just to have them
 	 * initialised. */
-	c->x = c->oldx = wa->x;
-	c->y = c->oldy = wa->y;
-	c->w = c->oldw = wa->width;
-	c->h = c->oldh = wa->height;
+	c->x = c->cold->oldx = wa->x;
+	c->y = c->cold->oldy = wa->y;
+	c->w = c->cold->oldw = wa->width;
+	c->h = c->cold->oldh = wa->height;
 	/* Store the previous border width. Intended to be used to restore the border width when
 	 * unmanaging a client that is not destroyed. */
-	c->oldbw = wa->border_width;
+	c->cold->oldbw = wa->border_width;
 
 	/* Reads and stores the window title in the client's name variable. */
 	updatetitle(c);
@@ -3704,7 +5013,7 @@ manage(Window w, XWindowAttributes *wa)
 	 * Check if the window is a transient for a parent window, and if so check if this parent
 	 * window (t) is managed by the window manager.
 	 */
-	if (XGetTransientForHint(dpy, w, &trans) && (t = wintoclient(trans))) {
+	if (gettransient(w, &trans) && (t = wintoclient(trans))) {
 		/* A transient window inherits the monitor and tags from its parent window. */
 		c->mon = t->mon;
 		c->tags = t->tags;
@@ -3747,6 +5056,8 @@ manage(Window w, XWindowAttributes *wa)
 	/* This reads window management hints for the client window. In practice it just checks
 	 * whether the window is urgent or not and whether the window expects input focus or not. */
 	updatewmhints(c);
+	/* This checks whether the client supports the _NET_WM_SYNC_REQUEST protocol. */
+	updatesynccounter(c);
 	/* This tells the X server what events we are interested in receiving for this window. */
 	XSelectInput(dpy, w, EnterWindowMask|FocusChangeMask|PropertyChangeMask|StructureNotifyMask);
 	/* The grabbuttons tells the X server what button press events we are interested in
@@ -3754,13 +5065,14 @@ manage(Window w, XWindowAttributes *wa)
 	grabbuttons(c, 0);
 	/* Transient and fixed windows are forced to be floating. */
 	if (!c->isfloating)
-		c->isfloating = c->oldstate = trans != None || c->isfixed;
+		c->isfloating = c->cold->oldstate = trans != None || c->isfixed;
 	/* Floating windows are raised to be shown above others. */
 	if (c->isfloating)
 		XRaiseWindow(dpy, c->win);
 	/* Add the client to the client list. New clients are always added at the top of the list
 	 * making them the new master client. */
 	attach(c);
+	winadd(w, c, NULL);
 	/* Add the client to the stacking order list. New additions are always added at the top of
 	 * the list to indicate order in which clients had focus. */
 	attachstack(c);
@@ -3786,6 +5098,7 @@ manage(Window w, XWindowAttributes *wa)
 	/* Finally a focus to give input focus to the next client in line (will be the new client,
 	 * if shown, otherwise it will likely be the previously selected client). */
 	focus(NULL);
+	TRACEEND();
 }
 
 /* This handles MappingNotify events coming from the X server.
@@ -3807,9 +5120,11 @@ mappingnotify(XEvent *e)
 
 	/* Refreshes the stored modifier and keymap information. */
 	XRefreshKeyboardMapping(ev);
-	/* If the event was in relation to new keyboard mapping then we make a call to grabkeys.
-	 * This to inform the X server what keypress events we are interested in receiving. */
-	if (ev->request == MappingKeyboard)
+	/* If the event was in relation to new keyboard or modifier mapping then we make a call to
+	 * grabkeys. This to inform the X server what keypress events we are interested in receiving.
+	 * This also updates the Num Lock modifier, which may have changed with a new modifier
+	 * mapping, as the numlockmask is otherwise only looked up on startup. */
+	if (ev->request == MappingKeyboard || ev->request == MappingModifier)
 		grabkeys();
 }
 
@@ -3826,7 +5141,7 @@ mappingnotify(XEvent *e)
  * @called_from run (the event handler)
  * @called_from movemouse as it forwards events to maprequest
  * @called_from resizemouse as it forwards events to maprequest
- * @calls XGetWindowAttributes https://tronche.com/gui/x/xlib/window-information/XGetWindowAttributes.html
+ * @calls getattributes to get the window attributes
  * @calls wintoclient to check whether the window manager is already managing this window
  * @calls manage to make the window manager manage the window and create the client
  *
@@ -3863,7 +5178,7 @@ maprequest(XEvent *e)
 	 * control over the window. A good example of this is dmenu which controls the size and
 	 * position on its own and does not want the window manager to intervene.
 	 */
-	if (!XGetWindowAttributes(dpy, ev->window, &wa) || wa.override_redirect)
+	if (!getattributes(ev->window, &wa) || wa.override_redirect)
 		return;
 
 	/* The wintoclient function returns the client that relates to the given window. If one is
@@ -3877,101 +5192,69 @@ maprequest(XEvent *e)
 }
 
 /* This is what handles the monocle layout arrangement.
+ *
+ * In the monocle layout every tiled client takes up the entire window area, but only the topmost
+ * tiled client in the stack can actually be seen. Rather than resizing every tiled client each
+ * time the monitor is arranged, which for many clients means many configure requests and many
+ * clients redrawing their contents for nothing, only the topmost tiled client is resized here.
+ * The other clients are resized when they come to the top of the stack by receiving focus,
+ * refer to the focus function. As such they still take up the entire window area when shown.
  *
  * @called_from arrangemon
+ * @called_from prearrange to lay out a tag that is not viewed
  * @calls snprintf to update the layout symbol of the monitor
- * @calls nexttiled to get the next tiled client
+ * @calls updatevisible to update the arrays of visible clients
  * @calls resize to change the size and position of client windows
  *
  * Internal call stack:
  *    ~ -> arrange -> arrangemon -> monocle
+ *    main -> run -> prearrangetimeout -> prearrange -> monocle
  */
 void
 monocle(Monitor *m)
 {
-	unsigned int n = 0; /* number of clients */
+	unsigned int n; /* number of clients */
 	Client *c;
 
-	/* This for loop is just to get a count of all visible clients on the selected tag(s).
-	 * Note that this counts both tiled and floating clients. This number is then used to
-	 * update the layout symbol in the bar to say e.g. [3].
+	/* This gets a count of all visible clients on the selected tag(s), refer to the
+	 * updatevisible function. Note that this counts both tiled and floating clients. This
+	 * number is then used to update the layout symbol in the bar to say e.g. [3].
 	 */
-	for (c = m->clients; c; c = c->next)
-		if (ISVISIBLE(c))
-			n++;
+	if (!m->visvalid)
+		updatevisible(m);
+	n = m->nvis;
 	/* The layout symbol of the monitor is only overwritten if there are clients visible
 	 * on the selected tag(s). Look up snprintf you are unsure what this does, but the gist
 	 * of it is that it replaces the %d format inside the string "[%d]" with the value of n
 	 * (e.g. 3) and writes the output to the monitor layout symbol (m->ltsymbol) and it writes
-	 * at most 16 bytes (sizeof m->ltsymbol) to that variable.
-	 */
-	if (n > 0) /* override layout symbol */
-		snprintf(m->ltsymbol, sizeof m->ltsymbol, "[%d]", n);
-	/* This just loops through all tiled clients and resizes them to take up the entire window
-	 * area. Note that this does not have anything to do with which window is shown on top, that
-	 * is determined by the window that has focus which will be above other tiled windows in the
-	 * stack.
-	 */
-	for (c = nexttiled(m->clients); c; c = nexttiled(c->next))
-		resize(c, m->wx, m->wy, m->ww - 2 * c->bw, m->wh - 2 * c->bw, 0);
-}
-
-
-/* This handles MotionNotify events coming from the X server.
- *
- * These events happen whenever the mouse cursor moves over the root window or other windows that
- * subscribe to motion notifications by setting the PointerMotionMask event mask. An example would
- * be to set that event mask for the bar should you want to have things happen when you hover the
- * mouse cursor over the bar. That would generate events which would then be handled in this
- * function.
- *
- * @called_from run (the event handler)
- * @calls recttomon to check which monitor the cursor is on
- * @calls unfocus in the event of the selected monitor changing
- * @calls focus in the event of the selected monitor changing
- *
- * Internal call stack:
- *    run -> motionnotify
- */
-void
-motionnotify(XEvent *e)
-{
-	static Monitor *mon = NULL;
-	Monitor *m;
-	XMotionEvent *ev = &e->xmotion;
-
-	/* Ignore the motion event if it was not for the root window */
-	if (ev->window != root)
-		return;
-	/* This makes a call to recttomon (rectangle to monitor) with the coordinates of the mouse
-	 * pointer to work out which monitor the mouse cursor is on. We only enter the if statement
-	 * if the monitor has changed. Note that the mon variable is static, which means that it is
-	 * only declared and initialised to NULL once and it will retain the set value for all
-	 * subsequent calls to this function.
+	 * at most 16 bytes (sizeof m->ltsymbol) to that variable.
 	 */
-	if ((m = recttomon(ev->x_root, ev->y_root, 1, 1)) != mon && mon) {
-		/* In the event that the monitor has changed then we unfocus the selected client
-		 * on the current monitor before switching over. */
-		unfocus(selmon->sel, 1);
-		/* We set the selected monitor to be the one the mouse cursor is currently on. */
-		selmon = m;
-		/* Passing NULL to the focus function will result in the client at the top of the
-		 * stack to receive focus, i.e. the window that last had focus on this monitor. */
-		focus(NULL);
-	}
-	/* Set the static mon variable to be the monitor the mouse cursor is on. */
-	mon = m;
+	if (n > 0) /* override layout symbol */
+		snprintf(m->ltsymbol, sizeof m->ltsymbol, "[%d]", n);
+	/* This finds the topmost tiled client in the stack, which is the one that is shown on top
+	 * of the other tiled clients, and resizes it to take up the entire window area. When laying
+	 * out a tag that is not viewed this is the topmost tiled client on that tag. */
+	for (c = m->stack; c; c = c->snext)
+		if (!c->isfloating
+		&& (prearranging ? tagstest(&c->tags, prearranging - 1) : ISVISIBLE(c)))
+			break;
+	if (c)
+		resize(c, m->wx, m->wy, m->ww - 2 * c->bw, m->wh - 2 * c->bw, 0);
 }
 
 /* User function to move a (floating) window around using the mouse.
  *
  * @called_from buttonpress in relation to button bindings
- * @calls XGrabPointer https://tronche.com/gui/x/xlib/input/XGrabPointer.html
+ * @calls grabpointer to grab the mouse pointer
  * @calls XUngrabPointer https://tronche.com/gui/x/xlib/input/XUngrabPointer.html
- * @calls XMaskEvent https://tronche.com/gui/x/xlib/event-handling/manipulating-event-queue/XMaskEvent.html
+ * @calls dragevent to get the next event and to pace the moving of clients
  * @calls restack to place the selected client above other floating windows if floating
  * @calls getrootptr to find the mouse pointer coordinates
+ * @calls XGrabServer https://tronche.com/gui/x/xlib/window-and-session-manager/XGrabServer.html
+ * @calls XUngrabServer https://tronche.com/gui/x/xlib/window-and-session-manager/XUngrabServer.html
  * @calls togglefloating to make a tiled window snap out to become floating
+ * @calls applysizehints to work out the geometry of the wireframe outline
+ * @calls drawoutline to draw and erase the wireframe outline
  * @calls resize to move the window to the new position
  * @calls recttomon to work out what monitor the client is on after having been moved
  * @calls sendmon to send the client to the other monitor if the client's monitor has changed
@@ -3984,11 +5267,10 @@ motionnotify(XEvent *e)
 void
 movemouse(const Arg *arg)
 {
-	int x, y, ocx, ocy, nx, ny;
+	int x, y, ocx, ocy, nx, ny, tx = 0, ty = 0, tw = 0, th = 0, wire, shown = 0;
 	Client *c;
 	Monitor *m;
 	XEvent ev;
-	Time lasttime = 0;
 
 	/* If there is no selected client then there is nothing to do here. This is merely a
 	 * safeguard in the event the function is called / used incorrectly. Under normal
@@ -4016,8 +5298,7 @@ movemouse(const Arg *arg)
 	 * events related to the mouse, in particular MotionNotify events. We also change the cursor
 	 * to indicate that we are performing a window move operation. If we were not able to grab
 	 * the pointer for whatever reason then we bail. */
-	if (XGrabPointer(dpy, root, False, MOUSEMASK, GrabModeAsync, GrabModeAsync,
-		None, cursor[CurMove]->cursor, CurrentTime) != GrabSuccess)
+	if (!grabpointer(CurMove))
 		return;
 
 	/* Here we ask for the mouse pointer coordinates and store these in the integer variables of
@@ -4025,6 +5306,15 @@ movemouse(const Arg *arg)
 	if (!getrootptr(&x, &y))
 		return;
 
+	/* In wireframe mode the client window is left alone while it is being moved and we only
+	 * draw an outline of where it will end up. The client is then moved once when the mouse
+	 * button is released. This is useful for heavy clients that are slow to redraw. Wireframe
+	 * mode is enabled for the client through client rules, or by binding movemouse with a
+	 * non-zero argument. We grab the server to prevent other clients from drawing over the
+	 * outline, refer to the drawoutline function. */
+	if ((wire = arg->i || c->cold->wireframe))
+		XGrabServer(dpy);
+
 	/* Keep doing this until the button is released. */
 	do {
 		/* Consider that we have received a ButtonPress event, which results in the run
@@ -4040,35 +5330,25 @@ movemouse(const Arg *arg)
 		 * The below code handles MotionNotify events, but forwards ConfigureRequest, Expose
 		 * and MapRequest events to their respective event handlers.
 		 *
-		 * The XMaskEvent call asks for the next event whose type falls under the given event
-		 * masks.
+		 * The dragevent call asks for the next of these events, pacing the MotionNotify
+		 * events to the refresh rate of the monitor.
 		 */
-		XMaskEvent(dpy, MOUSEMASK|ExposureMask|SubstructureRedirectMask, &ev);
+		dragevent(&ev, 1, 0);
 
 		switch(ev.type) {
 		case ConfigureRequest:
 		case Expose:
 		case MapRequest:
 			/* Events for the above event types are forwarded to their respective event
-			 * handler function. */
+			 * handler function. Any wireframe outline is erased first and redrawn
+			 * afterwards as the handlers may move windows or redraw the bar. */
+			if (shown)
+				drawoutline(c, tx, ty, tw, th);
 			handler[ev.type](&ev);
+			if (shown)
+				drawoutline(c, tx, ty, tw, th);
 			break;
 		case MotionNotify:
-			/* Motion notify events can come in quick, very quick in fact, so we skip
-			 * events received between certain intervals.
-			 *
-			 * The (1000 / 60) means that we want to process 60 events per second. This
-			 * corresponds to processing one event per 16.66 milliseconds.
-			 *
-			 * The value is a good middle-ground in terms of performance on older systems
-			 * and responsiveness. Some people may find that the interaction is not
-			 * entirely smooth and they can try increasing this to process 120 events per
-			 * second (1000 / 120) which means one event every 8.33 milliseconds.
-			 */
-			if ((ev.xmotion.time - lasttime) <= (1000 / 60))
-				continue;
-			lasttime = ev.xmotion.time; /* Store the previous time for comparison above */
-
 			/* Here we calculate the new x and y coordinates which are the original
 			 * coordinates plus the relative distance that the mouse cursor has moved. */
 			nx = ocx + (ev.xmotion.x - x);
@@ -4105,13 +5385,40 @@ movemouse(const Arg *arg)
 			/* We only actually move the window if we are in floating layout or the window
 			 * is actually floating. This has to do with that we may be dealing with a
 			 * tiled window that has not yet snapped out to become floating (as per the
-			 * above code). */
-			if (!selmon->lt[selmon->sellt]->arrange || c->isfloating)
-				resize(c, nx, ny, c->w, c->h, 1);
+			 * above code).
+			 *
+			 * In wireframe mode we erase the previous outline and draw a new one instead.
+			 * The size hints are applied to the new geometry so that the outline shows
+			 * where the client will actually end up. */
+			if (!selmon->lt[selmon->sellt]->arrange || c->isfloating) {
+				if (!wire) {
+					resize(c, nx, ny, c->w, c->h, 1);
+					break;
+				}
+				if (shown)
+					drawoutline(c, tx, ty, tw, th);
+				tx = nx;
+				ty = ny;
+				tw = c->w;
+				th = c->h;
+				applysizehints(c, &tx, &ty, &tw, &th, 1);
+				drawoutline(c, tx, ty, tw, th);
+				shown = 1;
+			}
 			break;
 		}
 	} while (ev.type != ButtonRelease);
 
+	/* In wireframe mode we erase the outline, release the server and move the client to where
+	 * the outline was. */
+	if (wire) {
+		if (shown)
+			drawoutline(c, tx, ty, tw, th);
+		XUngrabServer(dpy);
+		if (shown)
+			resize(c, tx, ty, tw, th, 1);
+	}
+
 	/* We no longer need to be spammed about mouse movement so we ungrab the mouse pointer.
 	 * Other programs may need it. */
 	XUngrabPointer(dpy, CurrentTime);
@@ -4127,17 +5434,48 @@ movemouse(const Arg *arg)
 	}
 }
 
+#ifdef XRANDR
+/* This moves a client to another monitor, keeping its tags.
+ *
+ * Unlike sendmon this does not change focus or arrange any monitors as it is used when moving
+ * many clients in one go, after which the caller takes care of that.
+ *
+ * @called_from updategeom to move clients away from and back to RandR monitors
+ * @calls detach and detachstack to remove the client from the old monitor
+ * @calls attach and attachstack to add the client to the new monitor
+ *
+ * Internal call stack:
+ *    ~ -> geomtimeout -> updategeom -> movetomon
+ */
+void
+movetomon(Client *c, Monitor *m)
+{
+	unsigned int i;
+
+	detach(c);
+	detachstack(c);
+	/* Make sure that no tag on the old monitor remembers the client as the client that last
+	 * had focus. */
+	for (i = 0; i <= LENGTH(tags); i++)
+		if (c->mon->pertag[i].sel == c)
+			c->mon->pertag[i].sel = NULL;
+	c->mon = m;
+	attach(c);
+	attachstack(c);
+}
+#endif /* XRANDR */
+
 /* This returns the next tiled client on the currently selected tag(s).
  *
  * Given an input client c the function returns the next visible tiled client in the list, or NULL
  * if there are no more subsequent tiled clients.
  *
- * @called_from tile for tiling purposes
- * @called_from monocle for tiling purposes
+ * Note that the layouts use the array of visible tiled clients maintained by the updatevisible
+ * function instead.
+ *
  * @called_from zoom to check if the selected client is the master client
  *
  * Internal call stack:
- *    ~ -> arrange -> arrangemon -> tile / monocle -> nexttiled
  *    run -> keypress -> zoom -> nexttiled
  */
 Client *
@@ -4150,6 +5488,64 @@ nexttiled(Client *c)
 	return c;
 }
 
+/* This returns the current time of the monotonic clock in milliseconds, which unlike the time
+ * of day does not jump when the system clock is changed.
+ *
+ * @called_from dragevent to pace the handling of MotionNotify events
+ * @called_from resizemouse to time how long a client takes to catch up with a resize
+ * @calls clock_gettime https://man7.org/linux/man-pages/man2/clock_gettime.2.html
+ * @returns the current time in milliseconds
+ *
+ * Internal call stack:
+ *    run -> buttonpress -> movemouse / resizemouse -> dragevent -> nowms
+ *    run -> buttonpress -> resizemouse -> nowms
+ */
+long
+nowms(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+/* This restores the layout state of the tag(s) viewed on a monitor after the view has changed.
+ *
+ * Each tag has its own layout, master / stack factor, number of master clients, bar visibility
+ * and last focused client, kept in the pertag array of the monitor. Viewing a single tag restores
+ * the state of that tag while viewing several tags at once uses a state that is shared between
+ * all such views. Switching between tags is then just a matter of copying the state of the entry
+ * into the monitor, after which the caller does a single arrange using the restored layout.
+ *
+ * Rather than using the togglebar function, which would arrange the monitor, the bar is shown or
+ * hidden directly if the tag's bar visibility differs from the current one.
+ *
+ * @called_from view and toggleview when the viewed tags change
+ * @calls updatebarpos to update the bar position and the window area of the monitor
+ * @calls XMoveResizeWindow https://tronche.com/gui/x/xlib/window/XMoveResizeWindow.html
+ *
+ * Internal call stack:
+ *    run -> keypress / buttonpress -> view / toggleview -> pertagview
+ */
+void
+pertagview(Monitor *m)
+{
+	Pertag *pt;
+
+	m->curtag = tagssingle(&m->tagset[m->seltags]);
+	pt = &m->pertag[m->curtag];
+	m->nmaster = pt->nmaster;
+	m->mfact = pt->mfact;
+	m->sellt = pt->sellt;
+	m->lt[0] = pt->lt[0];
+	m->lt[1] = pt->lt[1];
+	if (m->showbar != pt->showbar) {
+		m->showbar = pt->showbar;
+		updatebarpos(m);
+		XMoveResizeWindow(dpy, m->barwin, m->wx, m->by, m->ww, bh);
+	}
+}
+
 /* This function moves a client to the top of the tile stack, making it the new master window.
  *
  * @called_from zoom to move the selected client to become the new master
@@ -4172,11 +5568,120 @@ pop(Client *c)
 	arrange(c->mon); /* Rearrange all tiled windows as the order has changed */
 }
 
+/* This lays out the clients on a tag that is not viewed as if that tag was viewed on its own.
+ *
+ * The arrange function only lays out the clients that are visible, which means that clients on
+ * tags that are not viewed keep their old size and position when new clients are added to the
+ * tag, clients are removed or the monitor changes size. When such a tag is viewed then all of its
+ * clients have to be resized at that very moment, and the time that takes grows with the number
+ * of clients.
+ *
+ * Instead the prearrangetimeout function calls this once dwm has been idle for a while, laying
+ * out the clients using the layout, master / stack factor, number of master clients and bar
+ * visibility of the tag (refer to the pertagview function). The clients are kept out of view
+ * while doing so, refer to the resizeclient function. When the tag is later viewed the layout
+ * finds that the clients already have the right size and position, so viewing the tag only
+ * involves moving the clients into view.
+ *
+ * The layout works on the array of tiled clients of the monitor, so this temporarily fills that
+ * array with the tiled clients on the tag. The array is rebuilt the next time it is needed.
+ *
+ * Clients that are also shown on the viewed tags are not resized, refer to the resize function.
+ * Clients that are shown on more than one tag that is not viewed end up being laid out for the
+ * last of those tags, in which case they are resized when one of the other tags is viewed.
+ *
+ * @called_from prearrangetimeout to lay out tags that are not viewed
+ * @calls updatevisible to make sure that the array of tiled clients is large enough
+ * @calls updatebarpos to work out the window area when the tag has a different bar visibility
+ * @calls tile or monocle, depending on the layout of the tag
+ *
+ * Internal call stack:
+ *    main -> run -> prearrangetimeout -> prearrange
+ */
+void
+prearrange(Monitor *m, unsigned int t)
+{
+	Pertag *pt = &m->pertag[t + 1];
+	char ltsymbol[sizeof m->ltsymbol];
+	int nmaster = m->nmaster, showbar = m->showbar;
+	float mfact = m->mfact;
+	Client *c;
+
+	/* Nothing to lay out if the tag uses the floating layout. */
+	if (!pt->lt[pt->sellt]->arrange)
+		return;
+
+	if (!m->visvalid)
+		updatevisible(m);
+	for (m->ntiled = 0, c = m->clients; c; c = c->next)
+		if (tagstest(&c->tags, t) && !c->isfloating)
+			m->tiled[m->ntiled++] = c;
+
+	/* The monocle layout writes the number of clients to the layout symbol, so this is kept
+	 * to be restored afterwards. */
+	memcpy(ltsymbol, m->ltsymbol, sizeof ltsymbol);
+	m->nmaster = pt->nmaster;
+	m->mfact = pt->mfact;
+	if (m->showbar != pt->showbar) {
+		m->showbar = pt->showbar;
+		updatebarpos(m);
+	}
+
+	prearranging = t + 1;
+	pt->lt[pt->sellt]->arrange(m);
+	prearranging = 0;
+
+	m->nmaster = nmaster;
+	m->mfact = mfact;
+	if (m->showbar != showbar) {
+		m->showbar = showbar;
+		updatebarpos(m);
+	}
+	memcpy(m->ltsymbol, ltsymbol, sizeof ltsymbol);
+	m->visvalid = 0;
+}
+
+/* This is called when the prearrange timer expires, i.e. when dwm has not arranged any monitor
+ * for prearrangedelay milliseconds.
+ *
+ * Each call lays out at most one tag that is not viewed and that has not been laid out since the
+ * monitor was last arranged, after which the timer is started again with a minimal delay. This
+ * way X events that come in while working through the tags are not held up for long.
+ *
+ * @called_from run when the prearrange timer expires
+ * @calls prearrange to lay out a tag that is not viewed
+ * @calls settimer to come back for the next tag
+ *
+ * Internal call stack:
+ *    main -> run -> prearrangetimeout
+ */
+void
+prearrangetimeout(void)
+{
+	Monitor *m;
+	unsigned int t;
+
+	for (m = mons; m; m = m->next) {
+		for (t = 0; t < LENGTH(tags); t++) {
+			if (m->pertag[t + 1].gen == m->gen || tagstest(&m->tagset[m->seltags], t))
+				continue;
+			m->pertag[t + 1].gen = m->gen;
+			/* Tags without clients have nothing to lay out. */
+			if (!m->nocc[t])
+				continue;
+			prearrange(m, t);
+			settimer(prearrangetimer, 1);
+			return;
+		}
+	}
+}
+
 void
 propertynotify(XEvent *e)
 {
 	Client *c;
 	Window trans;
+	Tagset urg;
 	XPropertyEvent *ev = &e->xproperty;
 
 	if ((ev->window == root) && (ev->atom == XA_WM_NAME))
@@ -4187,16 +5692,24 @@ propertynotify(XEvent *e)
 		switch(ev->atom) {
 		default: break;
 		case XA_WM_TRANSIENT_FOR:
-			if (!c->isfloating && (XGetTransientForHint(dpy, c->win, &trans)) &&
-				(c->isfloating = (wintoclient(trans)) != NULL))
+			if (!c->isfloating && gettransient(c->win, &trans) &&
+				(c->isfloating = (wintoclient(trans)) != NULL)) {
+				c->mon->visvalid = 0;
 				arrange(c->mon);
+			}
 			break;
 		case XA_WM_NORMAL_HINTS:
 			c->hintsvalid = 0;
 			break;
 		case XA_WM_HINTS:
+			/* The hints may have changed the urgency of the client, in which case the
+			 * bar only needs to be redrawn if a tag's urgent status changed with it. */
+			urg = c->mon->urg;
+			counttags(c, -1);
 			updatewmhints(c);
-			drawbars();
+			counttags(c, 1);
+			if (!tagsequal(&c->mon->urg, &urg))
+				drawbar(c->mon);
 			break;
 		}
 		if (ev->atom == XA_WM_NAME || ev->atom == netatom[NetWMName]) {
@@ -4206,6 +5719,8 @@ propertynotify(XEvent *e)
 		}
 		if (ev->atom == netatom[NetWMWindowType])
 			updatewindowtype(c);
+		if (ev->atom == wmatom[WMProtocols] || ev->atom == netatom[NetWMSyncRequestCounter])
+			updatesynccounter(c);
 	}
 }
 
@@ -4234,16 +5749,14 @@ quit(const Arg *arg)
  * the x and y coordinates are those of the mouse pointer and the heigh and width are simply 1 to
  * refer to that particular point.
  *
- * @called_from motionnotify to check which monitor the mouse cursor is on
  * @called_from movemouse to check if a moved client window has moved over to another monitor
  * @called_from resizemouse to check if a moved client window has moved over to another monitor
  * @called_from wintomon to check which monitor the mouse cursor is on
  *
  * Internal call stack:
- *    run -> motionnotify -> recttomon
  *    run -> buttonpress -> movemouse / resizemouse -> recttomon
  *    run -> buttonpress / enternotify / expose -> wintomon -> recttomon
- *    run -> configurenotify -> updategeom -> wintomon -> rectomon
+ *    main -> run -> geomtimeout -> updategeom -> wintomon -> rectomon
  *    main -> setup -> updategeom -> wintomon -> rectomon
  */
 Monitor *
@@ -4251,6 +5764,23 @@ recttomon(int x, int y, int w, int h)
 {
 	Monitor *m, *r = selmon;
 	int a, area = 0;
+	unsigned int i, cell;
+
+	/* A single point, as is the case for the mouse pointer, is looked up in the grid rather
+	 * than checked against every monitor. Only the monitors that overlap the grid cell that
+	 * the point is in need to be checked, which is typically just the one. Refer to the
+	 * updatemontab function. The monitors are checked in the same order as below so the result
+	 * is the same. */
+	if (w == 1 && h == 1) {
+		if (x < gridx || y < gridy
+		|| (x - gridx) / gridw >= GRIDSIZE || (y - gridy) / gridh >= GRIDSIZE)
+			return r;
+		cell = (y - gridy) / gridh * GRIDSIZE + (x - gridx) / gridw;
+		for (i = gridstart[cell]; i < gridstart[cell + 1]; i++)
+			if (INTERSECT(x, y, w, h, gridmons[i]) > 0)
+				return gridmons[i];
+		return r;
+	}
 
 	/* INTERSECT is a macro that calculates how much of the area of the given rectangle is
 	 * covered by the given monitor.
@@ -4311,7 +5841,9 @@ recttomon(int x, int y, int w, int h)
  *
  * @called_from monocle for tiling purposes
  * @called_from movemouse to change position of the client window
+ * @called_from prearrange, by way of the layout, to lay out clients on tags that are not viewed
  * @called_from resizemouse to change the size of the client window
+ * @called_from focus to resize a client coming to the top in the monocle layout
  * @called_from showhide to move the window back into view when shown
  * @called_from tile for tiling purposes
  * @called_from togglefloating to resize the window taking size hints into account
@@ -4327,6 +5859,10 @@ recttomon(int x, int y, int w, int h)
 void
 resize(Client *c, int x, int y, int w, int h, int interact)
 {
+	/* When laying out a tag that is not viewed, clients that are also shown on the viewed tags
+	 * are left alone. Refer to the prearrange function. */
+	if (prearranging && ISVISIBLE(c))
+		return;
 	/* Note how the above variables are passed by reference to applysizehints. This is because
 	 * that function manipulates the variables before we pass them on to resizeclient (provided
 	 * that a resize is deemed necessary). If these were not passed by reference then they would
@@ -4340,7 +5876,7 @@ resize(Client *c, int x, int y, int w, int h, int interact)
  *
  * @called_from resize to change the size of the client window after size hints have been checked
  * @called_from setfullscreen when moving a window into and out of fullscreen
- * @called_from configurenotify to restore fullscreen after a monitor change
+ * @called_from geomtimeout to restore fullscreen after a monitor change
  * @calls XConfigureWindow https://tronche.com/gui/x/xlib/window/XConfigureWindow.html
  * @calls XSync https://tronche.com/gui/x/xlib/event-handling/XSync.html
  * @calls configure to send an event to the window indicating that the size has changed
@@ -4348,26 +5884,30 @@ resize(Client *c, int x, int y, int w, int h, int interact)
  * Internal call stack:
  *    ~ -> resize -> resizeclient
  *    run -> clientmessage / updatewindowtype -> setfullscreen -> resizeclient
- *    run -> configurenotify -> resizeclient
+ *    main -> run -> geomtimeout -> resizeclient
  */
 void
 resizeclient(Client *c, int x, int y, int w, int h)
 {
 	XWindowChanges wc;
 
-	/* There are three things happening here:
-	 *    - the existing x, y, w and h are stored in oldx, oldy, oldw and oldh respectively and
+	/* There are two things happening here:
 	 *    - the new x, y, w and h are stored in the client for future reference and
 	 *    - the new x, y, w and h are stored in the XWindowChanges structure
 	 *
-	 * The oldx, oldy, etc. values are only ever used in the setfullscreen function, so setting
-	 * those here is only in relation to the resizeclient call being made in that function.
+	 * The previous size and position are only needed when a client exits fullscreen, so they
+	 * are saved by the setfullscreen function rather than here. This keeps the rarely used
+	 * ClientCold struct out of the way when clients are laid out.
 	 */
-	c->oldx = c->x; c->x = wc.x = x;
-	c->oldy = c->y; c->y = wc.y = y;
-	c->oldw = c->w; c->w = wc.width = w;
-	c->oldh = c->h; c->h = wc.height = h;
+	c->x = wc.x = x;
+	c->y = wc.y = y;
+	c->w = wc.width = w;
+	c->h = wc.height = h;
 	wc.border_width = c->bw;
+	/* Clients that are laid out while their tag is not viewed are kept out of view, in the same
+	 * place that showhide would have moved them to. Refer to the prearrange function. */
+	if (prearranging)
+		wc.x = WIDTH(c) * -2;
 	/* This calls reconfigures the window's size, position and border according to the
 	 * XWindowChanges structure that have been populated with data above. */
 	XConfigureWindow(dpy, c->win, CWX|CWY|CWWidth|CWHeight|CWBorderWidth, &wc);
@@ -4378,19 +5918,29 @@ resizeclient(Client *c, int x, int y, int w, int h)
 	configure(c);
 	/* This flushes the output buffer and then waits until all requests have been received and
 	 * processed by the X server. */
+	TRACEBEGIN("XSync");
 	XSync(dpy, False);
+	TRACEEND();
 }
 
 /* User function to resize a (floating) window using the mouse.
  *
  * @called_from buttonpress in relation to button bindings
- * @calls XGrabPointer https://tronche.com/gui/x/xlib/input/XGrabPointer.html
+ * @calls grabpointer to grab the mouse pointer
  * @calls XUngrabPointer https://tronche.com/gui/x/xlib/input/XUngrabPointer.html
  * @calls XWarpPointer https://tronche.com/gui/x/xlib/input/XWarpPointer.html
- * @calls XMaskEvent https://tronche.com/gui/x/xlib/event-handling/manipulating-event-queue/XMaskEvent.html
- * @calls XCheckMaskEvent https://tronche.com/gui/x/xlib/event-handling/manipulating-event-queue/XCheckMaskEvent.html
+ * @calls XNoOp https://tronche.com/gui/x/xlib/display/XNoOp.html
+ * @calls XSyncDestroyAlarm https://www.x.org/releases/current/doc/xextproto/sync.html
+ * @calls createalarm to set up the _NET_WM_SYNC_REQUEST handshake with the client
+ * @calls syncresize to resize clients that support the _NET_WM_SYNC_REQUEST protocol
+ * @calls dragevent to get the next event and to pace the resizing of clients that do not
+ *        support the _NET_WM_SYNC_REQUEST protocol
  * @calls restack to place the selected client above other floating windows if floating
+ * @calls XGrabServer https://tronche.com/gui/x/xlib/window-and-session-manager/XGrabServer.html
+ * @calls XUngrabServer https://tronche.com/gui/x/xlib/window-and-session-manager/XUngrabServer.html
  * @calls togglefloating to make a tiled window snap out to become floating
+ * @calls applysizehints to work out the geometry of the wireframe outline
+ * @calls drawoutline to draw and erase the wireframe outline
  * @calls resize to change the size of the window while respecting size hints
  * @calls recttomon to work out what monitor the client is on after having been resized
  * @calls sendmon to send the client to the other monitor if the client's monitor has changed
@@ -4403,11 +5953,15 @@ resizeclient(Client *c, int x, int y, int w, int h)
 void
 resizemouse(const Arg *arg)
 {
-	int ocx, ocy, nw, nh;
+	int ocx, ocy, nw = 0, nh = 0, tx = 0, ty = 0, tw = 0, th = 0, wire, shown = 0;
+	int syncwait = 0, pending = 0;
 	Client *c;
 	Monitor *m;
 	XEvent ev;
+	XSyncAlarm alarm = None;
+	XSyncAlarmNotifyEvent *ae;
 	Time lasttime = 0;
+	long synctime = 0;
 
 	/* If there is no selected client then there is nothing to do here. This is merely a
 	 * safeguard in the event the function is called / used incorrectly. Under normal
@@ -4434,8 +5988,7 @@ resizemouse(const Arg *arg)
 	 * events related to the mouse, in particular MotionNotify events. We also change the cursor
 	 * to indicate that we are performing a window resize operation. If we were not able to grab
 	 * the pointer for whatever reason then we bail. */
-	if (XGrabPointer(dpy, root, False, MOUSEMASK, GrabModeAsync, GrabModeAsync,
-		None, cursor[CurResize]->cursor, CurrentTime) != GrabSuccess)
+	if (!grabpointer(CurResize))
 		return;
 
 	/* Here we move the mouse cursor to the bottom right corner of the window. This is known to
@@ -4443,6 +5996,17 @@ resizemouse(const Arg *arg)
 	 * changed using xinput. */
 	XWarpPointer(dpy, None, c->win, 0, 0, 0, 0, c->w + c->bw - 1, c->h + c->bw - 1);
 
+	/* In wireframe mode the client window is left alone while it is being resized and we only
+	 * draw an outline of the new size, refer to the movemouse function for details. */
+	if ((wire = arg->i || c->cold->wireframe))
+		XGrabServer(dpy);
+	/* Clients that support the _NET_WM_SYNC_REQUEST protocol tell us when they have finished
+	 * redrawing after having been resized. For these clients we only send the next size once
+	 * the client has caught up with the previous one, rather than queueing up resizes that a
+	 * slow client can not keep up with. Refer to the syncresize function. */
+	else if (c->cold->synccounter)
+		alarm = createalarm(c);
+
 	/* Keep doing this until the button is released. */
 	do {
 		/* Consider that we have received a ButtonPress event, which results in the run
@@ -4458,34 +6022,37 @@ resizemouse(const Arg *arg)
 		 * The below code handles MotionNotify events, but forwards ConfigureRequest, Expose
 		 * and MapRequest events to their respective event handlers.
 		 *
-		 * The XMaskEvent call asks for the next event whose type falls under the given event
-		 * masks.
+		 * Unlike movemouse we also need the XSync alarm events that tell us that the client
+		 * has caught up with a resize. The dragevent call asks for the next of these events.
+		 * Clients that support the _NET_WM_SYNC_REQUEST protocol are paced by the client, so
+		 * for these MotionNotify events are not paced to the refresh rate of the monitor.
 		 */
-		XMaskEvent(dpy, MOUSEMASK|ExposureMask|SubstructureRedirectMask, &ev);
+		if (!dragevent(&ev, alarm == None, pending ? synctime + syncrequesttimeout : 0)) {
+			/* The client has not caught up with the previous size within
+			 * syncrequesttimeout milliseconds, so we stop waiting for it and send the
+			 * latest size. The ev variable still holds the previous event, which was not
+			 * a ButtonRelease event. */
+			if ((syncwait = syncresize(c, alarm, nw, nh, lasttime)))
+				synctime = nowms();
+			pending = 0;
+			continue;
+		}
 
 		switch(ev.type) {
 		case ConfigureRequest:
 		case Expose:
 		case MapRequest:
 			/* Events for the above event types are forwarded to their respective event
-			 * handler function. */
+			 * handler function. Any wireframe outline is erased first and redrawn
+			 * afterwards as the handlers may move windows or redraw the bar. */
+			if (shown)
+				drawoutline(c, tx, ty, tw, th);
 			handler[ev.type](&ev);
+			if (shown)
+				drawoutline(c, tx, ty, tw, th);
 			break;
 		case MotionNotify:
-			/* Motion notify events can come in quick, very quick in fact, so we skip
-			 * events received between certain intervals.
-			 *
-			 * The (1000 / 60) means that we want to process 60 events per second. This
-			 * corresponds to processing one event per 16.66 milliseconds.
-			 *
-			 * The value is a good middle-ground in terms of performance on older systems
-			 * and responsiveness. Some people may find that the interaction is not
-			 * entirely smooth and they can try increasing this to process 120 events per
-			 * second (1000 / 120) which means one event every 8.33 milliseconds.
-			 */
-			if ((ev.xmotion.time - lasttime) <= (1000 / 60))
-				continue;
-			lasttime = ev.xmotion.time; /* Store the previous time for comparison above */
+			lasttime = ev.xmotion.time;
 
 			/* This calculates the new width based on the coordinates of the window and
 			 * the distance that the mouse cursor has moved. The MAX is a guard to prevent
@@ -4512,13 +6079,71 @@ resizemouse(const Arg *arg)
 			/* We only actually resize the window if we are in floating layout or the
 			 * window is actually floating. This has to do with that we may be dealing
 			 * with a tiled window that has not yet snapped out to become floating (as
-			 * per the above code). */
-			if (!selmon->lt[selmon->sellt]->arrange || c->isfloating)
-				resize(c, c->x, c->y, nw, nh, 1);
+			 * per the above code).
+			 *
+			 * In wireframe mode we erase the previous outline and draw a new one instead,
+			 * with the size hints applied as they would be for the actual resize. */
+			if (!selmon->lt[selmon->sellt]->arrange || c->isfloating) {
+				if (!wire && alarm == None) {
+					resize(c, c->x, c->y, nw, nh, 1);
+					break;
+				}
+				/* If the client has not yet caught up with the previous size then we hold
+				 * on to the new size until it does, or until it has had syncrequesttimeout
+				 * milliseconds to do so in which case we stop waiting for it. */
+				if (!wire) {
+					if (syncwait && nowms() - synctime < syncrequesttimeout)
+						pending = 1;
+					else {
+						if ((syncwait = syncresize(c, alarm, nw, nh, lasttime)))
+							synctime = nowms();
+						pending = 0;
+					}
+					break;
+				}
+				if (shown)
+					drawoutline(c, tx, ty, tw, th);
+				tx = c->x;
+				ty = c->y;
+				tw = nw;
+				th = nh;
+				applysizehints(c, &tx, &ty, &tw, &th, 1);
+				drawoutline(c, tx, ty, tw, th);
+				shown = 1;
+			}
+			break;
+		default:
+			/* This is an XSync alarm event telling us that the client has caught up with
+			 * the previous size, in which case we send the latest size if there is one. */
+			ae = (XSyncAlarmNotifyEvent *)&ev;
+			if (ae->alarm != alarm || !XSyncValueGreaterOrEqual(ae->counter_value, c->cold->syncvalue))
+				break;
+			syncwait = 0;
+			if (pending && (syncwait = syncresize(c, alarm, nw, nh, lasttime)))
+				synctime = nowms();
+			pending = 0;
 			break;
 		}
 	} while (ev.type != ButtonRelease);
 
+	/* Clean up the XSync alarm and apply the last size should the client not have caught up
+	 * with it before the mouse button was released. */
+	if (alarm != None) {
+		XSyncDestroyAlarm(dpy, alarm);
+		if (pending)
+			resize(c, c->x, c->y, nw, nh, 1);
+	}
+
+	/* In wireframe mode we erase the outline, release the server and resize the client to the
+	 * size of the outline. */
+	if (wire) {
+		if (shown)
+			drawoutline(c, tx, ty, tw, th);
+		XUngrabServer(dpy);
+		if (shown)
+			resize(c, tx, ty, tw, th, 1);
+	}
+
 	/* We warp the cursor again to be at the bottom left of the window. In principle it should
 	 * already be there, but depending on size hints it may not be. This is just correcting in
 	 * case it is not. */
@@ -4528,12 +6153,12 @@ resizemouse(const Arg *arg)
 	 * Other programs may need it. */
 	XUngrabPointer(dpy, CurrentTime);
 
-	/* This seemingly benign line of code is actually very important. What this does is that
-	 * it checks the X event queue if there are any EnterNotify events waiting as a result
-	 * of the resize action above and simply swallows (ignores) them. This avoids situations
-	 * where two overlapping windows begin to flicker back and forth due to competing and
-	 * continuously generated EnterNotify events. */
-	while (XCheckMaskEvent(dpy, EnterWindowMask, &ev));
+	/* This makes the enternotify function ignore EnterNotify events generated as a result of
+	 * the resize action above, refer to the restack function for details. This avoids
+	 * situations where two overlapping windows begin to flicker back and forth due to
+	 * competing and continuously generated EnterNotify events. */
+	ignoreserial = NextRequest(dpy);
+	XNoOp(dpy);
 
 	/* The call to recttomon checks if the client position and size is more on another monitor
 	 * after we have resized it, and if so then we call sendmon to make sure that the client is
@@ -4560,8 +6185,8 @@ resizemouse(const Arg *arg)
  * @called_from resizemouse to make the window being reized above others if floating
  * @calls XRaiseWindow https://tronche.com/gui/x/xlib/window/XRaiseWindow.html
  * @calls XConfigureWindow https://tronche.com/gui/x/xlib/window/XConfigureWindow.html
- * @calls XSync https://tronche.com/gui/x/xlib/event-handling/XSync.html
- * @calls XCheckMaskEvent https://tronche.com/gui/x/xlib/event-handling/manipulating-event-queue/XCheckWindowEvent.html
+ * @calls NextRequest https://tronche.com/gui/x/xlib/display/display-macros.html#NextRequest
+ * @calls XNoOp https://tronche.com/gui/x/xlib/display/XNoOp.html
  * @calls drawbar as restack and drawbar are often two calls that are done together
  *
  * Internal call stack:
@@ -4574,9 +6199,10 @@ void
 restack(Monitor *m)
 {
 	Client *c;
-	XEvent ev;
 	XWindowChanges wc;
 
+	TRACEBEGIN("restack");
+
 	/* The drawbar call here stands out as being misplaced as it has nothing to do with the
 	 * objective of the function, neither does the restacking affect anything in the bar.
 	 * Most likely it has been added out of convenience because often when restack is called we
@@ -4585,8 +6211,10 @@ restack(Monitor *m)
 	drawbar(m);
 
 	/* Bail if there is no selected client on the given monitor. */
-	if (!m->sel)
+	if (!m->sel) {
+		TRACEEND();
 		return;
+	}
 
 	/* If the selected client is floating, or if we are using floating layout, then place the
 	 * selected window above all other windows. */
@@ -4612,16 +6240,52 @@ restack(Monitor *m)
 				wc.sibling = c->win;
 			}
 	}
-	/* This flushes the output buffer and then waits until all requests have been
-	 * received and processed by the X server. */
-	XSync(dpy, False);
-	/* This seemingly benign line of code is actually very important. What this does is that
-	 * it checks the X event queue if there are any EnterNotify events waiting as a result
-	 * of the change in stacking order above and simply swallows (ignores) them. This avoids
-	 * situations where two overlapping windows begin to flicker back and forth due to competing
-	 * and continuously generated EnterNotify events. */
-	while (XCheckMaskEvent(dpy, EnterWindowMask, &ev));
+	/* This seemingly benign line of code is actually very important. Changing the stacking
+	 * order can put a different window under the mouse cursor, which results in EnterNotify
+	 * events that have nothing to do with the user moving the mouse. If these were handled
+	 * then two overlapping windows could begin to flicker back and forth due to competing and
+	 * continuously generated EnterNotify events.
+	 *
+	 * Every event carries the sequence number (serial) of the last request that the X server
+	 * had processed when the event was generated. Here we record the sequence number of the
+	 * next request, and the enternotify function ignores EnterNotify events that have a lower
+	 * serial, i.e. those that were generated by the above requests. The XNoOp request (which
+	 * does nothing) makes sure that the mouse cursor entering a window after this point gives
+	 * an event with a serial that is not lower, even if dwm sends no other requests.
+	 *
+	 * Unlike waiting for the X server to process the requests (XSync) and then throwing away
+	 * all EnterNotify events in the event queue, this does not involve a round trip and does
+	 * not throw away events caused by the user moving the mouse in the meantime. */
+	ignoreserial = NextRequest(dpy);
+	XNoOp(dpy);
+	TRACEEND();
+}
+
+#ifdef XRANDR
+/* This handles RRScreenChangeNotify and RRNotify events, which the X server sends when outputs
+ * are connected, disconnected or reconfigured.
+ *
+ * The XRRUpdateConfiguration call lets Xlib know about the new screen size. The monitors are then
+ * updated once the events have settled, refer to the configurenotify function.
+ *
+ * @called_from run (the event handler)
+ * @calls XRRUpdateConfiguration https://linux.die.net/man/3/xrandr
+ * @calls settimer to update the monitors once the events have settled
+ * @calls geomtimeout to update the monitors straight away if geomdelay is 0
+ *
+ * Internal call stack:
+ *    run -> rrnotify
+ */
+void
+rrnotify(XEvent *e)
+{
+	XRRUpdateConfiguration(e);
+	if (geomdelay)
+		settimer(geomtimer, geomdelay);
+	else
+		geomtimeout();
 }
+#endif /* XRANDR */
 
 /* The run function is what starts the event handler, which is the heart of dwm.
  *
@@ -4634,9 +6298,50 @@ restack(Monitor *m)
  *    The event handlers of dwm are organized in an array which is accessed whenever
  *    a new event has been fetched. This allows event dispatching in O(1) time.
  *
+ * Rather than handling events strictly in the order that they arrive, the event handler reads all
+ * events that are available at the time into a local event queue (evq) and dispatches them in two
+ * passes:
+ *    - first all user input events, i.e. KeyPress, ButtonPress, MotionNotify and EnterNotify
+ *      (as well as the corresponding release events to keep them in order with the presses)
+ *    - then everything else, which are mostly notifications originating from client windows
+ *
+ * The reason for this is that a client can flood the X event queue with e.g. PropertyNotify or
+ * Expose events, in which case a keypress would otherwise have to wait for all of those to be
+ * handled before anything happens on screen. Input events keep their relative order, as do the
+ * other events.
+ *
+ * A ButtonPress is special in that it may result in movemouse or resizemouse being called, which
+ * run their own event loop waiting for the ButtonRelease event. As such all events that have not
+ * yet been dispatched are put back on the X event queue before the ButtonPress is handled.
+ *
+ * When there are no X events left to handle the event loop waits on an epoll instance rather than
+ * blocking in XNextEvent. The epoll instance covers the X connection as well as other event
+ * sources such as the signal file descriptor and timers, refer to the addsource function. This is
+ * what allows dwm to do timed work, for example to limit how often the status text is redrawn.
+ * If there are no running timers then the event loop only wakes up when something happens.
+ *
+ * A word of warning regarding the X connection. Xlib reads events from the connection into its
+ * own internal queue, not only when we ask for events but also as a side effect of other calls
+ * that wait for a reply from the X server (e.g. XSync). As such the X connection not being
+ * readable does not mean that there are no events waiting to be handled, which is why XPending
+ * is always checked before blocking on the epoll instance.
+ *
+ * If dwm is compiled with -DSTATS (see config.mk) then the time from reading an input event until
+ * the handler has finished is recorded and reported when dwm exits. The time each handler takes
+ * and the number of events read in one go are recorded as well, refer to the statswrite function.
+ *
+ * If dwm is compiled with -DTRACE then the handling of each event can be traced, refer to the
+ * traceopen function.
+ *
  * @called_by main to start the event handler
  * @calls XNextEvent https://tronche.com/gui/x/xlib/event-handling/manipulating-event-queue/XNextEvent.html
+ * @calls XPending https://tronche.com/gui/x/xlib/event-handling/XPending.html
+ * @calls XPutBackEvent https://tronche.com/gui/x/xlib/event-handling/XPutBackEvent.html
  * @calls XSync https://tronche.com/gui/x/xlib/event-handling/XSync.html
+ * @calls epoll_wait https://man7.org/linux/man-pages/man2/epoll_wait.2.html
+ * @calls read https://man7.org/linux/man-pages/man2/read.2.html
+ * @calls functions registered as event sources, e.g. sigevent and statustimeout
+ * @calls rrnotify to handle RandR events if dwm is compiled with RandR support
  * @calls buttonpress to handle ButtonPress event types
  * @calls clientmessage to handle ClientMessage event types
  * @calls configurerequest to handle ConfigureRequest event types
@@ -4648,7 +6353,6 @@ restack(Monitor *m)
  * @calls keypress to handle KeyPress event types
  * @calls mappingnotify to handle MappingNotify event types
  * @calls maprequest to handle MapRequest event types
- * @calls motionnotify to handle MotionNotify event types
  * @calls propertynotify to handle PropertyNotify event types
  * @calls unmapnotify to handle UnmapNotify event types
  *
@@ -4658,27 +6362,112 @@ restack(Monitor *m)
 void
 run(void)
 {
+	int i, j, n, pass;
+	uint64_t expirations;
+	struct epoll_event ee[LENGTH(sources)];
+	Source *src;
 	XEvent ev;
+#ifdef STATS
+	unsigned long t, now;
+#endif /* STATS */
+
 	/* main event loop */
 	XSync(dpy, False);
 
-	/* The XNextEvent function copies the first event from the event queue into the specified
-	 * XEvent structure and then removes it from the queue. If the event queue is empty, then
-	 * XNextEvent flushes the output buffer and blocks until an event is received. */
-	while (running && !XNextEvent(dpy, &ev))
-		/* This calls the function corresponding to the specific event type. If we do not
-		 * have an event handler for the given event type then the event is ignored. Refer
-		 * to the handler array for how the event types and functions are mapped. */
-		if (handler[ev.type])
-			handler[ev.type](&ev); /* call handler */
+	while (running) {
+		/* XPending returns the number of events waiting in Xlib's event queue. If there are
+		 * none then it flushes the output buffer and reads any events that are available on
+		 * the X connection without blocking.
+		 *
+		 * If there are X events waiting then we only check the other event sources without
+		 * waiting, so that a steady stream of X events does not hold up timers and signals.
+		 * Otherwise we wait until one of the event sources becomes readable. The wait is
+		 * interrupted (EINTR) if e.g. the process is stopped and continued, in which case we
+		 * simply try again. */
+		if ((n = epoll_wait(epfd, ee, LENGTH(ee), XPending(dpy) ? 0 : -1)) == -1 && errno != EINTR)
+			die("epoll_wait:");
+		for (i = 0; i < n; i++) {
+			src = &sources[ee[i].data.u32];
+			/* Reading from a timer resets it, if there was nothing to read then the timer
+			 * has already been handled or it has been changed. */
+			if (src->istimer
+			&& read(src->fd, &expirations, sizeof expirations) != sizeof expirations)
+				continue;
+			if (src->func)
+				src->func();
+		}
+		/* Go back to waiting if there are no X events, the X connection merely became readable. */
+		if (!running || !XPending(dpy))
+			continue;
+
+		/* The XNextEvent function copies the first event from the event queue into the
+		 * specified XEvent structure and then removes it from the queue. We keep reading
+		 * events for as long as XPending says that there are more available, or until the
+		 * local event queue is full. */
+		for (evqlen = 0; evqlen < LENGTH(evq) && XPending(dpy); evqlen++)
+			XNextEvent(dpy, &evq[evqlen]);
+#ifdef STATS
+		inputlat.time = statsnow();
+		histadd(&queuedepth, evqlen);
+#endif /* STATS */
+
+		/* Pass 0 dispatches input events, pass 1 dispatches everything else. */
+		for (pass = 0; pass < 2; pass++) {
+			for (i = 0; i < evqlen && running; i++) {
+				/* Skip events that have already been handled as well as events that
+				 * belong to the other pass. */
+				if (!evq[i].type || ISINPUT(evq[i].type) == pass)
+					continue;
+				ev = evq[i];
+				evq[i].type = 0;
+				if (ev.type == ButtonPress) {
+					/* Put back the remaining events in reverse order so that they
+					 * end up at the front of the X event queue in the order that
+					 * they were received. */
+					for (j = evqlen - 1; j >= 0; j--)
+						if (evq[j].type)
+							XPutBackEvent(dpy, &evq[j]);
+					evqlen = 0;
+				}
+#ifdef STATS
+				t = statsnow();
+#endif /* STATS */
+				TRACEBEGIN(evnames[ev.type < LASTEvent ? ev.type : LASTEvent]);
+				/* This calls the function corresponding to the specific event type. If
+				 * we do not have an event handler for the given event type then the
+				 * event is ignored. Refer to the handler array for how the event types
+				 * and functions are mapped. Extension events have types beyond
+				 * LASTEvent and are ignored as well, unless handled below. This includes
+				 * XSync alarm events that arrive once a mouse resize has finished, such
+				 * as the one sent when the alarm is destroyed in resizemouse. */
+				if (ev.type < LASTEvent && handler[ev.type])
+					handler[ev.type](&ev); /* call handler */
+#ifdef XRANDR
+				/* Extension events are not in the handler array as their types are only
+				 * known at runtime. */
+				else if (haverandr && (ev.type == rrevbase + RRScreenChangeNotify
+				|| ev.type == rrevbase + RRNotify))
+					rrnotify(&ev);
+#endif /* XRANDR */
+				TRACEEND();
+#ifdef STATS
+				now = statsnow();
+				histadd(&eventstats[ev.type < LASTEvent ? ev.type : LASTEvent], now - t);
+				if (!pass)
+					histadd(&inputlat.hist, now - inputlat.time);
+#endif /* STATS */
+			}
+		}
+		evqlen = 0;
+	}
 }
 
 /* This queries the X server to find windows that can be managed by the window manager.
  *
  * @called_from main to find existing windows that can be managed
  * @calls XQueryTree https://tronche.com/gui/x/xlib/window-information/XQueryTree.html
- * @calls XGetWindowAttributes https://tronche.com/gui/x/xlib/window-information/XGetWindowAttributes.html
- * @calls XGetTransientForHint https://tronche.com/gui/x/xlib/ICC/client-to-window-manager/XGetTransientForHint.html
+ * @calls getattributes to get the window attributes
+ * @calls gettransient to check whether a window is transient for another window
  * @calls XFree https://tronche.com/gui/x/xlib/display/XFree.html
  * @calls getstate to check if the window state is iconic
  * @calls manage to make the window manager manage this window as a client
@@ -4695,9 +6484,13 @@ scan(void)
 	 * but the values are ignored. */
 	Window d1, d2, *wins = NULL;
 	XWindowAttributes wa;
+	int ret;
 
 	/* This asks the X server for a list of windows under the given root window. */
-	if (XQueryTree(dpy, root, &d1, &d2, &wins, &num)) {
+	TRACEBEGIN("XQueryTree");
+	ret = XQueryTree(dpy, root, &d1, &d2, &wins, &num);
+	TRACEEND();
+	if (ret) {
 		/* A transient window is intended to be a short lived window that belong to a parent
 		 * window. This might be a dialog box or a toolbox for example.
 		 *
@@ -4720,8 +6513,8 @@ scan(void)
 			 *    - we fail to read the window attributes for that window (in which case
 			 *      it is not the kind of window that the end user would interact with)
 			 */
-			if (!XGetWindowAttributes(dpy, wins[i], &wa)
-			|| wa.override_redirect || XGetTransientForHint(dpy, wins[i], &d1))
+			if (!getattributes(wins[i], &wa)
+			|| wa.override_redirect || gettransient(wins[i], &d1))
 				continue;
 
 			/* If the window is in a viewable map state or if the window is in an iconic
@@ -4741,7 +6534,7 @@ scan(void)
 		/* This second for loop goes through and handles all the transient windows. */
 		for (i = 0; i < num; i++) { /* now the transients */
 			/* As for normal windows we bail if we can not read the window attributes. */
-			if (!XGetWindowAttributes(dpy, wins[i], &wa))
+			if (!getattributes(wins[i], &wa))
 				continue;
 
 			/* If the window is transient and in a viewable state, or if it is in iconic
@@ -4750,7 +6543,7 @@ scan(void)
 			 * Notably a check to see if the window has the override-redirect flag is not
 			 * present here. This is likely an oversight, but transient windows for a
 			 * self-managing window is probably extremely rare. */
-			if (XGetTransientForHint(dpy, wins[i], &d1)
+			if (gettransient(wins[i], &d1)
 			&& (wa.map_state == IsViewable || getstate(wins[i]) == IconicState))
 				manage(wins[i], &wa);
 		}
@@ -4773,6 +6566,8 @@ scan(void)
 void
 sendmon(Client *c, Monitor *m)
 {
+	unsigned int i;
+
 	/* If the client is already on the target monitor then bail. */
 	if (c->mon == m)
 		return;
@@ -4784,8 +6579,15 @@ sendmon(Client *c, Monitor *m)
 	 * stacking order list before we can move the client. */
 	detach(c);
 	detachstack(c);
+	/* Make sure that no tag on the old monitor remembers the client as the client that last
+	 * had focus. */
+	for (i = 0; i <= LENGTH(tags); i++)
+		if (c->mon->pertag[i].sel == c)
+			c->mon->pertag[i].sel = NULL;
 	/* Set the client's monitor to be the target monitor. */
 	c->mon = m;
+	/* The user has chosen a monitor for the client, so forget where it used to be. */
+	c->cold->rrhome = None;
 	/* The client inherits the tag(s) the target monitor, as in the currently viewed tags on
 	 * that monitor. */
 	c->tags = m->tagset[m->seltags]; /* assign tags of target monitor */
@@ -4871,11 +6673,13 @@ sendevent(Client *c, Atom proto)
 	 * Not all windows supports all message types, so the below checks whether the given
 	 * protocol is supported by the window.
 	 */
+	TRACEBEGIN("XGetWMProtocols");
 	if (XGetWMProtocols(dpy, c->win, &protocols, &n)) {
 		while (!exists && n--)
 			exists = protocols[n] == proto;
 		XFree(protocols);
 	}
+	TRACEEND();
 	/* We only send the event if the client window supports the message type. */
 	if (exists) {
 		/* If you want to know more about the values set here then refer to the page on
@@ -4970,14 +6774,19 @@ setfullscreen(Client *c, int fullscreen)
 		c->isfullscreen = 1;
 		/* Record the state of the client before it went into fullscreen. This because we
 		 * want to revert to that when the client exits fullscreen. */
-		c->oldstate = c->isfloating;
-		c->oldbw = c->bw;
+		c->cold->oldstate = c->isfloating;
+		c->cold->oldbw = c->bw;
+		c->cold->oldx = c->x;
+		c->cold->oldy = c->y;
+		c->cold->oldw = c->w;
+		c->cold->oldh = c->h;
 		/* We do not want a border to be drawn for the fullscreen window. */
 		c->bw = 0;
 		/* A fullscreen window is floating above other windows. This is primarily to keep
 		 * the fullscreen window as-is on top of others in case an arrange or restack should
 		 * take place. */
 		c->isfloating = 1;
+		c->mon->visvalid = 0;
 		/* Resize the client to span the entire monitor. Note that we use the monitor
 		 * position and size here rather than the coordinates and size of the monitor window
 		 * area. More importantly we are calling resizeclient here rather than resize as we
@@ -4994,12 +6803,13 @@ setfullscreen(Client *c, int fullscreen)
 		/* Change the internal flag to say that the client is not in fullscreen. */
 		c->isfullscreen = 0;
 		/* Restore the old state, border width, size and position of the client. */
-		c->isfloating = c->oldstate;
-		c->bw = c->oldbw;
-		c->x = c->oldx;
-		c->y = c->oldy;
-		c->w = c->oldw;
-		c->h = c->oldh;
+		c->isfloating = c->cold->oldstate;
+		c->mon->visvalid = 0;
+		c->bw = c->cold->oldbw;
+		c->x = c->cold->oldx;
+		c->y = c->cold->oldy;
+		c->w = c->cold->oldw;
+		c->h = c->cold->oldh;
 		/* When exiting fullscreen we again make a call to resizeclient rather than resize.
 		 * This time it is not because we do not want size hints to interfere, but because
 		 * having set the position and size above the call to applysizehints would result in
@@ -5040,7 +6850,7 @@ setlayout(const Arg *arg)
 	 *    - if the new layout is different to the previous layout
 	 */
 	if (!arg || !arg->v || arg->v != selmon->lt[selmon->sellt])
-		selmon->sellt ^= 1;
+		selmon->sellt = selmon->pertag[selmon->curtag].sellt ^= 1;
 
 	/* Awkwardly this function expects a valid pointer to a layout to be passed as the
 	 * argument, e.g.
@@ -5063,7 +6873,7 @@ setlayout(const Arg *arg)
 	if (arg && arg->v)
 		/* This sets the selected montor's selected layout to the layout provided as the
 		 * argument. */
-		selmon->lt[selmon->sellt] = (Layout *)arg->v;
+		selmon->lt[selmon->sellt] = selmon->pertag[selmon->curtag].lt[selmon->sellt] = (Layout *)arg->v;
 
 	/* Copy the layout symbol of the given layout into the monitor's layout symbol. This is
 	 * later used when drawing the layout symbol on the bar. */
@@ -5125,12 +6935,17 @@ setmfact(const Arg *arg)
 	/* If the given float argument is less than 1.0 then make a relative adjustment of the mfact
 	 * value, otherwise set the mfact value absolutely. */
 	f = arg->f < 1.0 ? arg->f + selmon->mfact : arg->f - 1.0;
-	/* Check that the next factor value is within the bounds of the minimum of 0.5 and the
+	/* A relative adjustment that goes beyond the bounds of the minimum of 0.05 and the maximum
+	 * of 0.95 stops at the bound. This matters when the keypress function merges several key
+	 * presses into one larger adjustment. */
+	if (arg->f < 1.0)
+		f = MAX(0.05, MIN(f, 0.95));
+	/* Check that the next factor value is within the bounds of the minimum of 0.05 and the
 	 * maximum of 0.95. If it is not then we bail out here */
-	if (f < 0.05 || f > 0.95)
+	if (f < 0.05 || f > 0.95 || f == selmon->mfact)
 		return;
 	/* Set the master / stack factor to the new value */
-	selmon->mfact = f;
+	selmon->mfact = selmon->pertag[selmon->curtag].mfact = f;
 	/* This makes a call to arrange so that the tiled windows are resized and repositioned
 	 * following the change to the master / stack factor. In principle this could have been a
 	 * call to arrangemon(selmon) as all that is needed is for the clients to be tiled again.
@@ -5142,6 +6957,33 @@ setmfact(const Arg *arg)
 	arrange(selmon);
 }
 
+/* This starts a timer created with addtimer so that it expires once after the given number of
+ * milliseconds, at which point the event loop calls the function associated with the timer.
+ *
+ * Passing 0 for the number of milliseconds stops the timer if it is running.
+ *
+ * @called_from updatestatus to start the status redraw throttle timer
+ * @called_from enternotify to start the hover timer
+ * @called_from buttonpress to stop the hover timer
+ * @called_from focus to stop the hover timer when focus changes for another reason
+ * @calls timerfd_settime https://man7.org/linux/man-pages/man2/timerfd_settime.2.html
+ *
+ * Internal call stack:
+ *    run -> propertynotify -> updatestatus -> settimer
+ *    run -> enternotify -> settimer
+ *    run -> buttonpress -> settimer
+ *    run -> keypress -> focusstack -> focus -> settimer
+ */
+void
+settimer(int fd, unsigned int ms)
+{
+	struct itimerspec its = { 0 };
+
+	its.it_value.tv_sec = ms / 1000;
+	its.it_value.tv_nsec = (ms % 1000) * 1000000;
+	timerfd_settime(fd, 0, &its, NULL);
+}
+
 /* The setup call will initialise everything that we need for operational purposes.
  *
  * This involves:
@@ -5158,6 +7000,7 @@ setmfact(const Arg *arg)
  * @calls XCreateSimpleWindow https://tronche.com/gui/x/xlib/window/XCreateWindow.html
  * @calls XChangeProperty https://tronche.com/gui/x/xlib/window-information/XChangeProperty.html
  * @calls XDeleteProperty https://tronche.com/gui/x/xlib/window-information/XDeleteProperty.html
+ * @calls XCreateGC https://tronche.com/gui/x/xlib/GC/XCreateGC.html
  * @calls XChangeWindowAttributes https://tronche.com/gui/x/xlib/window/XChangeWindowAttributes.html
  * @calls XSelectInput https://tronche.com/gui/x/xlib/event-handling/XSelectInput.html
  * @calls DefaultScreen https://linux.die.net/man/3/defaultscreen
@@ -5166,7 +7009,13 @@ setmfact(const Arg *arg)
  * @calls RootWindow https://linux.die.net/man/3/rootwindow
  * @calls sigaction https://man7.org/linux/man-pages/man2/sigaction.2.html
  * @calls sigemptyset https://man7.org/linux/man-pages/man3/sigemptyset.3p.html
+ * @calls sigprocmask https://man7.org/linux/man-pages/man2/sigprocmask.2.html
+ * @calls signalfd https://man7.org/linux/man-pages/man2/signalfd.2.html
+ * @calls epoll_create1 https://man7.org/linux/man-pages/man2/epoll_create.2.html
  * @calls waitpid https://linux.die.net/man/3/waitpid
+ * @calls addsource to register the X connection and signals with the event loop
+ * @calls addtimer to create the timers used by dwm
+ * @calls XkbSetDetectableAutoRepeat https://www.x.org/releases/current/doc/libX11/XKB/xkblib.html
  * @calls ecalloc to allocate space for the colour schemes (see util.c)
  * @calls drw_create to create the drawable (see drw.c)
  * @calls drw_fontset_create to create the font set (see drw.c)
@@ -5192,43 +7041,52 @@ setup(void)
 {
 	int i;
 	XSetWindowAttributes wa;
+	XGCValues gcv;
+	int syncmajor, syncminor;
+#ifdef XRANDR
+	int rrmajor, rrminor, rrerrbase;
+#endif /* XRANDR */
 	Atom utf8string;
 	struct sigaction sa;
+#ifdef STATS
+	const char *dir, *display;
+#endif /* STATS */
+	sigset_t sigmask;
 
-	/* Do not transform children into zombies when they terminate. */
-
-	/* The sigemptyset function initialises an empty signal set; the return value indicating
-	 * success or failure is ignored. */
-	sigemptyset(&sa.sa_mask);
-
-	/* This sets the signal action flags that we want:
-	 *
-	 * SA_NOCLDSTOP - The default behaviour is that whenever a process dies or stops, or when
-	 *                a stopped child process continues execution, the kernel posts the SIGCHLD
-	 *                signal to the parent process. The SA_NOCLDSTOP flag means that no SIGCHLD
-	 *                will occur when a child process stops or resumes, i.e. we will only
-	 *                receive a SIGCHLD when the child process dies (terminates).
-	 * SA_NOCLDWAIT - This flags means that in the case when a SIGCHLD is received then do not
-	 *                transform the child process into a zombie process.
-	 * SA_RESTART   - It is possible for a signal to arrive and be handled while a primitive I/O
-	 *                operation such as open or read is waiting on an I/O device to respond. The
-	 *                POSIX way of handling this scenario is to make the primitive fail straight
-	 *                away with the EINTR error code. This means that POSIX applications that use
-	 *                signal handlers must check for EINTR errors after calls to library functions
-	 *                that can return it, and forgetting to check this is a common source of error.
-	 *                BSD on the other hand avoids EINTR entirely by providing a more convenient
-	 *                approach: to restart the interrupted primitive rather than making it fail.
-	 *                Using this approach one do not have to be concerned about checking for EINTR
-	 *                errors. The SA_RESTART flag tells the signal action handler to behave like
-	 *                BSD does by making certain system calls restartable across signals.
+	/* Rather than installing signal handlers, that can interrupt dwm at any point in time, we
+	 * block the signals that we are interested in and receive them as events through a signal
+	 * file descriptor instead. Refer to the sigevent function for how they are handled.
+	 *
+	 *    SIGCHLD - sent when a child process (e.g. something started via spawn) terminates, we
+	 *              need to wait for the child process to prevent it from becoming a zombie
+	 *    SIGINT  - interrupt, e.g. Ctrl+C in the terminal dwm was started from
+	 *    SIGTERM - a request to terminate, e.g. via the kill command
+	 *
+	 * The last two make dwm exit gracefully rather than just stopping dead in its tracks.
+	 *
+	 * The SIGCHLD signal action is explicitly set to the default. If the signal was ignored
+	 * (SIG_IGN) as inherited from the parent process then the kernel would discard it rather
+	 * than passing it on to the signal file descriptor.
+	 *
+	 * Blocked signals are inherited by child processes, refer to the spawn function for how
+	 * this is dealt with.
 	 */
-	sa.sa_flags = SA_NOCLDSTOP | SA_NOCLDWAIT | SA_RESTART;
-	/* This will set the signal handler and SIG_IGN will simply ignore any signals and we only
-	 * expect the SIGCHLD signal to be received when a child process dies. */
-	sa.sa_handler = SIG_IGN;
-	/* This sets our desired action when a SIGCHLD signal is received. */
+	sigemptyset(&sa.sa_mask);
+	sa.sa_flags = 0;
+	sa.sa_handler = SIG_DFL;
 	sigaction(SIGCHLD, &sa, NULL);
 
+	sigemptyset(&sigmask);
+	sigaddset(&sigmask, SIGCHLD);
+	sigaddset(&sigmask, SIGINT);
+	sigaddset(&sigmask, SIGTERM);
+#ifdef TRACE
+	sigaddset(&sigmask, SIGUSR1);
+#endif /* TRACE */
+	sigprocmask(SIG_BLOCK, &sigmask, NULL);
+	if ((sigfd = signalfd(-1, &sigmask, SFD_NONBLOCK|SFD_CLOEXEC)) == -1)
+		die("signalfd:");
+
 	/* Clean up any zombies (inherited from .xinitrc etc) immediately. The need for this may not
 	 * be immediately obvious, but for example when the .xinitrc script runs it may spawn other
 	 * processes. Typically at the end the exec command will be used, which results in the
@@ -5243,8 +7101,8 @@ setup(void)
 	 * 1111). Then exec dwm will replace the process evaluating .xinitrc and start executing as
 	 * dwm (i.e. PID 1111 is now executing dwm). The result of this is that the sleep is now
 	 * (still) a child process of dwm. When that child process exists after the 10 seconds have
-	 * elapsed it will result in a SIGCHLD and it will be dealt with by the sigaction handler as
-	 * defined above.
+	 * elapsed it will result in a SIGCHLD and it will be dealt with by the sigevent function via
+	 * the signal file descriptor set up above.
 	 *
 	 * What's with the waitpid then? Let's consider this other scenario:
 	 *
@@ -5253,7 +7111,7 @@ setup(void)
 	 *
 	 * Here the command of cat is run as a child process (e.g. PID 5183 with parent process 1111).
 	 * As before the exec will replace the current process and start executing dwm. The cat process
-	 * will have died before the sigaction handler was set up before so it will just end up as a
+	 * will have died before the signal file descriptor was set up so it will just end up as a
 	 * defunct zombie process waiting to terminate. The waitpid here will find and deal with (i.e.
 	 * ignore) any child processes that are waiting to terminate thus avoiding zombie processes.
 	 *
@@ -5274,6 +7132,32 @@ setup(void)
 	 */
 	while (waitpid(-1, NULL, WNOHANG) > 0);
 
+	/* This creates the epoll instance that the event loop waits on, and registers the X
+	 * connection and the signal file descriptor as event sources. Refer to the run function
+	 * for more details. */
+	if ((epfd = epoll_create1(EPOLL_CLOEXEC)) == -1)
+		die("epoll_create1:");
+	addsource(ConnectionNumber(dpy), 0, NULL);
+	addsource(sigfd, 0, sigevent);
+	statustimer = addtimer(statustimeout);
+	hovertimer = addtimer(hovertimeout);
+	prearrangetimer = addtimer(prearrangetimeout);
+	geomtimer = addtimer(geomtimeout);
+	/* The drag timer is only waited on while a window is dragged, so it is not registered with
+	 * the event loop. Refer to the dragevent function. */
+	if ((dragtimer = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK|TFD_CLOEXEC)) == -1)
+		die("timerfd_create:");
+#ifdef STATS
+	/* The statistics are written to a file in the user's runtime directory, which is named after
+	 * the display so that several X sessions do not overwrite each other's statistics. */
+	if (statsinterval && (dir = getenv("XDG_RUNTIME_DIR"))) {
+		display = strrchr(DisplayString(dpy), ':');
+		snprintf(statspath, sizeof statspath, "%s/dwm-%s.prom", dir, display ? display + 1 : "0");
+		statstimer = addtimer(statstimeout);
+		settimer(statstimer, statsinterval);
+	}
+#endif /* STATS */
+
 	/* Initialise the screen.
 	 *
 	 * The DefaultScreen macro returns the default screen number. The screen number is used
@@ -5314,15 +7198,38 @@ setup(void)
 	 * pixel above the text. */
 	bh = drw->fonts->h + 2;
 
-	/* The call to updategeom creates the monitor(s) based on Xinerama information, or it
-	 * creates a single monitor that spans all screens in the event that Xinerama is not
-	 * enabled for the screen or dwm is compiled without Xinerama support. */
+	/* Initialise the tag sets for all tags and for each individual tag. This needs to be
+	 * done before the monitors are created as these view the first tag by default. */
+	for (i = 0; i < LENGTH(tags); i++) {
+		tagsset(&tagmask, i);
+		tagsset(&tagbits[i], i);
+	}
+
+#ifdef XRANDR
+	/* If the X server supports RandR 1.5 then the monitors are set up based on the RandR
+	 * monitors rather than Xinerama, and we ask to be notified when the screen, the CRTCs or the
+	 * outputs change so that monitors can be added and removed as they come and go. */
+	if (XRRQueryExtension(dpy, &rrevbase, &rrerrbase) && XRRQueryVersion(dpy, &rrmajor, &rrminor)
+	&& (rrmajor > 1 || (rrmajor == 1 && rrminor >= 5))) {
+		haverandr = 1;
+		XRRSelectInput(dpy, root,
+			RRScreenChangeNotifyMask|RRCrtcChangeNotifyMask|RROutputChangeNotifyMask);
+	}
+#endif /* XRANDR */
+
+	/* The call to updategeom creates the monitor(s) based on RandR or Xinerama information, or
+	 * it creates a single monitor that spans all screens in the event that neither is enabled
+	 * for the screen or dwm is compiled without support for them. */
 	updategeom();
 
 	/* Initialise atoms. This looks up the atom ID numbers for later use. */
 	/* The utf8string is only used once when setting the WM_NAME property of the supporting
 	 * window. */
 	utf8string = XInternAtom(dpy, "UTF8_STRING", False);
+#ifdef STATS
+	/* The root window property that holds the statistics on request, see updatestats */
+	statsatom = XInternAtom(dpy, "_DWM_STATS", False);
+#endif /* STATS */
 
 	/* Looking up Window Management atoms:
 	 *    WMProtocols - used in sendevent
@@ -5355,12 +7262,30 @@ setup(void)
 	netatom[NetWMWindowType] = XInternAtom(dpy, "_NET_WM_WINDOW_TYPE", False);
 	netatom[NetWMWindowTypeDialog] = XInternAtom(dpy, "_NET_WM_WINDOW_TYPE_DIALOG", False);
 	netatom[NetClientList] = XInternAtom(dpy, "_NET_CLIENT_LIST", False);
+	netatom[NetWMSyncRequest] = XInternAtom(dpy, "_NET_WM_SYNC_REQUEST", False);
+	netatom[NetWMSyncRequestCounter] = XInternAtom(dpy, "_NET_WM_SYNC_REQUEST_COUNTER", False);
+
+	/* The XSync extension provides the counters and alarms used by the _NET_WM_SYNC_REQUEST
+	 * protocol, refer to the resizemouse function. If the X server does not support the
+	 * extension then clients are resized as if they did not support the protocol. */
+	havesync = XSyncQueryExtension(dpy, &syncevbase, &syncerrbase)
+		&& XSyncInitialize(dpy, &syncmajor, &syncminor);
 
 	/* Initialise different cursors for when resizing and moving windows. */
 	cursor[CurNormal] = drw_cur_create(drw, XC_left_ptr);
 	cursor[CurResize] = drw_cur_create(drw, XC_sizing);
 	cursor[CurMove] = drw_cur_create(drw, XC_fleur);
 
+	/* Initialise the graphics context for wireframe outlines. Drawing with the GXxor function
+	 * means that drawing the same outline twice restores what was there before, and the
+	 * IncludeInferiors subwindow mode makes the outline draw on top of client windows rather
+	 * than only on the visible parts of the root window. */
+	gcv.function = GXxor;
+	gcv.subwindow_mode = IncludeInferiors;
+	gcv.foreground = BlackPixel(dpy, screen) ^ WhitePixel(dpy, screen);
+	gcv.line_width = 0;
+	wiregc = XCreateGC(dpy, root, GCFunction|GCSubwindowMode|GCForeground|GCLineWidth, &gcv);
+
 	/* Initialise colour schemes. Allocate memory to hold pointers to all colour schemes. */
 	scheme = ecalloc(LENGTH(colors), sizeof(Clr *));
 
@@ -5452,7 +7377,6 @@ setup(void)
 	 *    SubstructureNotifyMask   - to receive ConfigureNotify, DestroyNotify, MapNotify and
 	 *                               UnmapNotify events (indicating a change for child windows)
 	 *    ButtonPressMask          - to receive ButtonPress events
-	 *    PointerMotionMask        - to receive MotionNotify events
 	 *    EnterWindowMask          - to receive EnterNotify events
 	 *    LeaveWindowMask          - to receive LeaveNotify events
 	 *    StructureNotifyMask      - to receive ConfigureNotify, DestroyNotify, MapNotify and
@@ -5464,9 +7388,14 @@ setup(void)
 	 *
 	 * See https://tronche.com/gui/x/xlib/events/processing-overview.html for a list of event
 	 * types and what event masks they correspond to.
+	 *
+	 * Note that we deliberately do not select PointerMotionMask for the root window, as that
+	 * would wake dwm up every time the mouse moves over the root window. To detect when the
+	 * mouse cursor moves over to another monitor each monitor has a desktop window instead,
+	 * refer to the updatebars function.
 	 */
 	wa.event_mask = SubstructureRedirectMask|SubstructureNotifyMask
-		|ButtonPressMask|PointerMotionMask|EnterWindowMask
+		|ButtonPressMask|EnterWindowMask
 		|LeaveWindowMask|StructureNotifyMask|PropertyChangeMask;
 
 	/* This sets the cursor and the event mask specified above for the root window. */
@@ -5480,6 +7409,12 @@ setup(void)
 	 * the window manager wants to receive KeyPress events for. */
 	grabkeys();
 
+	/* By default the keyboard auto-repeat sends a fake key release before each repeated key
+	 * press, which makes a held down key indistinguishable from a key that is pressed over and
+	 * over. Detectable auto-repeat removes the fake key releases, which lets the keypress
+	 * function recognise auto-repeated key presses. */
+	XkbSetDetectableAutoRepeat(dpy, True, NULL);
+
 	/* Given that we are only starting up and have not yet called scan to find any client
 	 * windows the focus call below is to revert the input focus back to the root window. */
 	focus(NULL);
@@ -5519,10 +7454,15 @@ seturgent(Client *c, int urg)
 	XWMHints *wmh;
 
 	/* This sets the internal urgency flag for the client */
+	counttags(c, -1);
 	c->isurgent = urg;
+	counttags(c, 1);
 	/* This retrieves window manager hints for the client window. If the client does not have
 	 * any then we bail here. */
-	if (!(wmh = XGetWMHints(dpy, c->win)))
+	TRACEBEGIN("XGetWMHints");
+	wmh = XGetWMHints(dpy, c->win);
+	TRACEEND();
+	if (!wmh)
 		return;
 	/* This updates the window manager hints flags by either adding or removing the XUrgencyHint
 	 * bit. This is a straightforward binary operation, but may warrant some explaining for
@@ -5629,6 +7569,70 @@ showhide(Client *c)
 	}
 }
 
+/* This handles signals received through the signal file descriptor that is set up in the setup
+ * function.
+ *
+ * Because the signals are handled as part of the event loop rather than in a signal handler there
+ * are no restrictions on what can be done here, unlike in a traditional signal handler which can
+ * only safely call async-signal-safe functions.
+ *
+ * Note that multiple instances of the same signal may be merged into one, so when receiving a
+ * SIGCHLD we need to reap all terminated child processes, not just the one.
+ *
+ * If dwm is compiled with -DTRACE (see config.mk) then SIGUSR1 starts and stops tracing, e.g.
+ *
+ *    $ pkill -USR1 -x dwm
+ *
+ * @called_from run when the signal file descriptor becomes readable
+ * @calls read https://man7.org/linux/man-pages/man2/read.2.html
+ * @calls waitpid https://linux.die.net/man/3/waitpid
+ * @calls traceopen and traceclose to start and stop tracing
+ * @see https://man7.org/linux/man-pages/man2/signalfd.2.html
+ *
+ * Internal call stack:
+ *    main -> run -> sigevent
+ */
+void
+sigevent(void)
+{
+	struct signalfd_siginfo si;
+#ifdef TRACE
+	static unsigned int ntraces = 0;
+	char path[PATH_MAX];
+	const char *dir;
+#endif /* TRACE */
+
+	while (read(sigfd, &si, sizeof si) == sizeof si) {
+		switch (si.ssi_signo) {
+		case SIGCHLD:
+			while (waitpid(-1, NULL, WNOHANG) > 0);
+			break;
+		case SIGINT:
+		case SIGTERM:
+			/* Makes the event loop exit, after which dwm cleans up and exits gracefully. */
+			running = 0;
+			break;
+#ifdef TRACE
+		case SIGUSR1:
+			/* Starts or stops tracing. Each trace is written to a new file in the user's
+			 * runtime directory, refer to the traceopen function. The file name holds the
+			 * process id, the time and a count of the traces so far, so that tracing can
+			 * be toggled several times within a second. */
+			if (tracing) {
+				traceclose();
+				break;
+			}
+			dir = getenv("XDG_RUNTIME_DIR");
+			snprintf(path, sizeof path, "%s/dwm-%d-%ld-%u.trace.json", dir ? dir : "/tmp",
+				(int)getpid(), (long)time(NULL), ntraces++);
+			if (traceopen(path))
+				fprintf(stderr, "dwm: tracing to %s\n", path);
+			break;
+#endif /* TRACE */
+		}
+	}
+}
+
 /* This starts a new program by executing a given execvp command.
  *
  * @called_from keypress in relation to keybindings
@@ -5637,6 +7641,7 @@ showhide(Client *c)
  * @calls close https://linux.die.net/man/2/close
  * @calls sigaction https://man7.org/linux/man-pages/man2/sigaction.2.html
  * @calls sigemptyset https://man7.org/linux/man-pages/man3/sigemptyset.3p.html
+ * @calls sigprocmask https://man7.org/linux/man-pages/man2/sigprocmask.2.html
  * @calls ConnectionNumber https://linux.die.net/man/3/connectionnumber
  * @calls setsid https://linux.die.net/man/2/setsid
  * @calls execvp https://linux.die.net/man/3/execvp
@@ -5709,19 +7714,231 @@ spawn(const Arg *arg)
 		sa.sa_flags = 0;
 		sa.sa_handler = SIG_DFL;
 		sigaction(SIGCHLD, &sa, NULL);
+		/* The signal mask is also inherited, and it is preserved across execvp, so we need to
+		 * unblock the signals that dwm receives via the signal file descriptor. Otherwise the
+		 * program would never see e.g. SIGINT or SIGCHLD. */
+		sigprocmask(SIG_SETMASK, &sa.sa_mask, NULL);
+
+		/* The execvp causes the program that is currently being run (dwm in this case) to
+		 * be replaced with a new program and with a newly initialised stack, heap and data
+		 * segments. If this is successful then this is the last thing this process does in
+		 * the dwm code. */
+		execvp(((char **)arg->v)[0], (char **)arg->v);
+		/* If the execvp fails for whatever reason, then we are still here executing dwm
+		 * code. So we make a call to die to print an error to say that we failed to execute the
+		 * command before calling exit to ensure that this process stops running. */
+		die("dwm: execvp '%s' failed:", ((char **)arg->v)[0]);
+	}
+}
+
+#ifdef STATS
+/* This returns the time of the monotonic clock in nanoseconds, used for the statistics.
+ *
+ * @called_from run, keypress and buttonpress to time event handlers and bound functions
+ * @calls clock_gettime https://man7.org/linux/man-pages/man2/clock_gettime.2.html
+ *
+ * Internal call stack:
+ *    main -> run -> statsnow
+ *    run -> keypress / buttonpress -> statsnow
+ */
+unsigned long
+statsnow(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1000000000UL + ts.tv_nsec;
+}
+
+/* This is called when the statistics timer expires, which happens every statsinterval
+ * milliseconds, and it writes the statistics to the statistics file.
+ *
+ * The statistics are written to a temporary file that is then renamed, so that a program reading
+ * the file (e.g. the textfile collector of the Prometheus node exporter) never sees a partially
+ * written file.
+ *
+ * @called_from run when the statistics timer expires
+ * @calls fopen https://man7.org/linux/man-pages/man3/fopen.3.html
+ * @calls rename https://man7.org/linux/man-pages/man2/rename.2.html
+ * @calls statswrite to write the statistics
+ * @calls settimer to write the statistics again after statsinterval milliseconds
+ *
+ * Internal call stack:
+ *    main -> run -> statstimeout
+ */
+void
+statstimeout(void)
+{
+	char tmp[PATH_MAX + 4];
+	FILE *f;
+
+	snprintf(tmp, sizeof tmp, "%s.tmp", statspath);
+	if ((f = fopen(tmp, "w"))) {
+		statswrite(f);
+		if (fclose(f) || rename(tmp, statspath))
+			unlink(tmp);
+	}
+	settimer(statstimer, statsinterval);
+}
+
+/* This writes the statistics in the Prometheus text format to the given stream. This covers:
+ *    - how long the handler of each event type takes (dwm_event_duration_seconds)
+ *    - how long the functions bound to keys and buttons take (dwm_binding_duration_seconds)
+ *    - the time from reading an input event until it has been handled (dwm_input_latency_seconds)
+ *    - the number of events read from the X server in one go (dwm_event_queue_depth)
+ *    - the number of objects and bytes in the client and monitor pools (dwm_pool_*)
+ *
+ * Only event types and bindings that have been used are included.
+ *
+ * @called_from statstimeout to write the statistics file
+ * @called_from updatestats to set the _DWM_STATS property of the root window
+ * @calls histwrite to write each histogram
+ * @calls poolbytes to work out the memory used by each pool
+ * @calls XKeysymToString https://tronche.com/gui/x/xlib/utilities/keyboard/XKeysymToString.html
+ *
+ * Internal call stack:
+ *    main -> run -> statstimeout -> statswrite
+ *    run -> clientmessage -> updatestats -> statswrite
+ */
+void
+statswrite(FILE *f)
+{
+	const struct { const char *name; const Pool *pool; } pools[] = {
+		{ "client", &clientpool },
+		{ "clientcold", &coldpool },
+		{ "monitor", &monpool },
+	};
+	char labels[128];
+	const char *keysym;
+	unsigned int i;
+
+	fputs("# HELP dwm_event_duration_seconds Time spent handling X events.\n"
+		"# TYPE dwm_event_duration_seconds histogram\n", f);
+	for (i = 0; i < LENGTH(eventstats); i++) {
+		if (!eventstats[i].count)
+			continue;
+		if (evnames[i])
+			snprintf(labels, sizeof labels, "event=\"%s\"", evnames[i]);
+		else
+			snprintf(labels, sizeof labels, "event=\"%u\"", i);
+		histwrite(f, "dwm_event_duration_seconds", labels, &eventstats[i], 1e-9);
+	}
+
+	/* Bindings are identified by their position in the keys and buttons arrays in config.h */
+	fputs("# HELP dwm_binding_duration_seconds Time spent in functions bound to keys and buttons.\n"
+		"# TYPE dwm_binding_duration_seconds histogram\n", f);
+	for (i = 0; i < LENGTH(keystats); i++) {
+		if (!keystats[i].count)
+			continue;
+		keysym = XKeysymToString(keys[i].keysym);
+		snprintf(labels, sizeof labels, "binding=\"key\",index=\"%u\",keysym=\"%s\"",
+			i, keysym ? keysym : "");
+		histwrite(f, "dwm_binding_duration_seconds", labels, &keystats[i], 1e-9);
+	}
+	for (i = 0; i < LENGTH(buttonstats); i++) {
+		if (!buttonstats[i].count)
+			continue;
+		snprintf(labels, sizeof labels, "binding=\"button\",index=\"%u\",button=\"%u\"",
+			i, buttons[i].button);
+		histwrite(f, "dwm_binding_duration_seconds", labels, &buttonstats[i], 1e-9);
+	}
 
-		/* The execvp causes the program that is currently being run (dwm in this case) to
-		 * be replaced with a new program and with a newly initialised stack, heap and data
-		 * segments. If this is successful then this is the last thing this process does in
-		 * the dwm code. */
-		execvp(((char **)arg->v)[0], (char **)arg->v);
-		/* If the execvp fails for whatever reason, then we are still here executing dwm
-		 * code. So we make a call to die to print an error to say that we failed to execute the
-		 * command before calling exit to ensure that this process stops running. */
-		die("dwm: execvp '%s' failed:", ((char **)arg->v)[0]);
+	fputs("# HELP dwm_input_latency_seconds Time from reading an input event until it has been handled.\n"
+		"# TYPE dwm_input_latency_seconds histogram\n", f);
+	histwrite(f, "dwm_input_latency_seconds", "", &inputlat.hist, 1e-9);
+
+	fputs("# HELP dwm_event_queue_depth Number of X events read in one go.\n"
+		"# TYPE dwm_event_queue_depth histogram\n", f);
+	histwrite(f, "dwm_event_queue_depth", "", &queuedepth, 1);
+
+	fputs("# HELP dwm_pool_objects Number of objects in use in each memory pool.\n"
+		"# TYPE dwm_pool_objects gauge\n", f);
+	for (i = 0; i < LENGTH(pools); i++)
+		fprintf(f, "dwm_pool_objects{pool=\"%s\"} %zu\n", pools[i].name, pools[i].pool->nused);
+	fputs("# HELP dwm_pool_objects_max Highest number of objects in use at the same time.\n"
+		"# TYPE dwm_pool_objects_max gauge\n", f);
+	for (i = 0; i < LENGTH(pools); i++)
+		fprintf(f, "dwm_pool_objects_max{pool=\"%s\"} %zu\n", pools[i].name, pools[i].pool->maxused);
+	fputs("# HELP dwm_pool_bytes Memory allocated for the slabs of each memory pool.\n"
+		"# TYPE dwm_pool_bytes gauge\n", f);
+	for (i = 0; i < LENGTH(pools); i++)
+		fprintf(f, "dwm_pool_bytes{pool=\"%s\"} %zu\n", pools[i].name, poolbytes(pools[i].pool));
+}
+#endif /* STATS */
+
+/* This is called when the status redraw throttle timer expires. If the status text changed while
+ * the timer was running then the bar is updated now with the latest status text.
+ *
+ * @called_from run when the status timer expires
+ * @calls updatestatus to redraw the status that changed while the timer was running
+ *
+ * Internal call stack:
+ *    main -> run -> statustimeout
+ */
+void
+statustimeout(void)
+{
+	statusbusy = 0;
+	if (statuspending) {
+		statuspending = 0;
+		updatestatus();
 	}
 }
 
+/* This resizes a client that supports the _NET_WM_SYNC_REQUEST protocol.
+ *
+ * Before the client is resized we send it a _NET_WM_SYNC_REQUEST client message holding the next
+ * value for the client's XSync counter, and we update the alarm to wait for the counter to reach
+ * that value. The resizemouse function then holds on to any further sizes until the alarm
+ * triggers. Refer to the createalarm function for details on the protocol.
+ *
+ * Note that the client is only resized, and the request only sent, if the size actually changes
+ * after having applied size hints. A client would otherwise never update the counter as it does
+ * not receive a ConfigureNotify event.
+ *
+ * @called_from resizemouse to resize the client
+ * @calls XSyncIntToValue https://www.x.org/releases/current/doc/xextproto/sync.html
+ * @calls XSyncValueAdd https://www.x.org/releases/current/doc/xextproto/sync.html
+ * @calls XSyncChangeAlarm https://www.x.org/releases/current/doc/xextproto/sync.html
+ * @calls XSendEvent https://tronche.com/gui/x/xlib/event-handling/XSendEvent.html
+ * @calls applysizehints to work out the size of the client
+ * @calls resizeclient to resize the client
+ * @returns 1 if the client was resized and we are waiting for it to catch up, 0 otherwise
+ *
+ * Internal call stack:
+ *    run -> buttonpress -> resizemouse -> syncresize
+ */
+int
+syncresize(Client *c, XSyncAlarm alarm, int w, int h, Time time)
+{
+	int x = c->x, y = c->y, overflow;
+	XSyncValue one;
+	XSyncAlarmAttributes aa;
+	XEvent ev;
+
+	if (!applysizehints(c, &x, &y, &w, &h, 1))
+		return 0;
+
+	XSyncIntToValue(&one, 1);
+	XSyncValueAdd(&c->cold->syncvalue, c->cold->syncvalue, one, &overflow);
+	aa.trigger.wait_value = c->cold->syncvalue;
+	XSyncChangeAlarm(dpy, alarm, XSyncCAValue, &aa);
+
+	ev.type = ClientMessage;
+	ev.xclient.window = c->win;
+	ev.xclient.message_type = wmatom[WMProtocols];
+	ev.xclient.format = 32;
+	ev.xclient.data.l[0] = netatom[NetWMSyncRequest];
+	ev.xclient.data.l[1] = time;
+	ev.xclient.data.l[2] = XSyncValueLow32(c->cold->syncvalue);
+	ev.xclient.data.l[3] = XSyncValueHigh32(c->cold->syncvalue);
+	ev.xclient.data.l[4] = 0;
+	XSendEvent(dpy, c->win, False, NoEventMask, &ev);
+
+	resizeclient(c, x, y, w, h);
+	return 1;
+}
+
 /* The tag function moves the selected client to a given tag.
  *
  * This is referenced in the TAGKEYS macro which sets up keybindings for each individual tag.
@@ -5730,7 +7947,7 @@ spawn(const Arg *arg)
  * @called_from buttonpress in relation to button bindings
  * @calls focus to give input focus to the next client in the stack
  * @calls arrange as the client may have been been moved out of view
- * @see TAGMASK macro
+ * @see tagmask variable
  *
  * Internal call stack:
  *    run -> keypress -> tag
@@ -5739,11 +7956,18 @@ spawn(const Arg *arg)
 void
 tag(const Arg *arg)
 {
+	Tagset newtags = { { 0 } };
+
 	/* Don't proceed if there are no selected clients or the given argument is not for any
 	 * valid tag. */
-	if (selmon->sel && arg->ui & TAGMASK) {
+	if (arg->v)
+		tagsand(&newtags, arg->v, &tagmask);
+	if (selmon->sel && !tagsempty(&newtags)) {
 		/* This sets the new tagmask for the selected client. */
-		selmon->sel->tags = arg->ui & TAGMASK;
+		counttags(selmon->sel, -1);
+		selmon->sel->tags = newtags;
+		counttags(selmon->sel, 1);
+		selmon->visvalid = 0;
 		/* Give input focus to the next client in the stack as the client may have been
 		 * moved to a tag that is not viewed. */
 		focus(NULL);
@@ -5777,11 +8001,13 @@ tagmon(const Arg *arg)
 /* This is what handles the tile layout arrangement.
  *
  * @called_from arrangemon
- * @calls nexttiled to get the next tiled client
+ * @called_from prearrange to lay out a tag that is not viewed
+ * @calls updatevisible to update the array of visible tiled clients
  * @calls resize to change the size and position of client windows
  *
  * Internal call stack:
  *    ~ -> arrange -> arrangemon -> tile
+ *    main -> run -> prearrangetimeout -> prearrange -> tile
  */
 void
 tile(Monitor *m)
@@ -5800,8 +8026,11 @@ tile(Monitor *m)
 	unsigned int i, n, h, mw, my, ty;
 	Client *c;
 
-	/* This loop just counts the number of tiled clients storing the count in the variable n. */
-	for (n = 0, c = nexttiled(m->clients); c; c = nexttiled(c->next), n++);
+	/* This makes sure that the array of visible tiled clients is up to date, the size of which
+	 * gives the number of tiled clients. Refer to the updatevisible function. */
+	if (!m->visvalid)
+		updatevisible(m);
+	n = m->ntiled;
 	/* If we have no tiled clients then there is nothing to do, stop processing now. */
 	if (n == 0)
 		return;
@@ -5831,7 +8060,7 @@ tile(Monitor *m)
 
 	/* This loops through all clients initialising i, the master y (my), and the stack y (ty)
 	 * to 0 while incrementing i for each client processed. */
-	for (i = my = ty = 0, c = nexttiled(m->clients); c; c = nexttiled(c->next), i++)
+	for (i = my = ty = 0; i < n && (c = m->tiled[i]); i++)
 		/* If this client goes into the master area (this includes the case where all
 		 * clients go into the master area). */
 		if (i < m->nmaster) {
@@ -5936,7 +8165,7 @@ void
 togglebar(const Arg *arg)
 {
 	/* Toggle the internal flag indicating whether the bar is shown or not */
-	selmon->showbar = !selmon->showbar;
+	selmon->showbar = selmon->pertag[selmon->curtag].showbar = !selmon->showbar;
 	/* The call to updatebarpos makes dwm adjust:
 	 *    - the bar y position (m->by) depending on whether the bar is shown or not and
 	 *    - the monitor's window area
@@ -5978,6 +8207,7 @@ togglefloating(const Arg *arg)
 	 * floating. A window is considered to be fixed in size if its size hints say that it has
 	 * a minimum size and a maximum size that is equal to the minimum size. */
 	selmon->sel->isfloating = !selmon->sel->isfloating || selmon->sel->isfixed;
+	selmon->visvalid = 0;
 	if (selmon->sel->isfloating)
 		/* Here we have an explicit call to resize if the window has become floating. This
 		 * call is only to allow the size hints for the window to be applied in the event
@@ -5998,7 +8228,7 @@ togglefloating(const Arg *arg)
  * @called_from buttonpress in relation to button bindings
  * @calls focus to give input focus to the next in the stack if the client is no longer shown
  * @calls arrange as the client window may have been toggled away from the current monitor
- * @see TAGMASK macro
+ * @see tagmask variable
  *
  * Internal call stack:
  *    run -> keypress -> toggletag
@@ -6007,7 +8237,7 @@ togglefloating(const Arg *arg)
 void
 toggletag(const Arg *arg)
 {
-	unsigned int newtags;
+	Tagset newtags = { { 0 } };
 
 	/* Bail if there are no visible clients */
 	if (!selmon->sel)
@@ -6022,16 +8252,16 @@ toggletag(const Arg *arg)
 	 *
 	 * Now let's say that the user hits the keybinding to toggle tag 5 for the client.
 	 *
-	 * The TAGKEYS macro passes an bit shifted unsigned int as the argument.
+	 * The TAGKEYS macro passes a Tagset holding the single tag as the argument.
 	 *
-	 *    { MODKEY|ControlMask|ShiftMask, KEY,      toggletag,      {.ui = 1 << TAG} },
+	 *    { MODKEY|ControlMask|ShiftMask, KEY,      toggletag,      {.v = TAGSET(TAG)} },
 	 *
-	 * In the keys array where the macro is used we can tell that for tag 5 the value of
-	 * 1 is shifted leftwards 4 times.
+	 * In the keys array where the macro is used we can tell that for tag 5 the bit at
+	 * index 4 is set.
 	 *
 	 *    	TAGKEYS(                        XK_5,                      4)
 	 *
-	 * 1 << 4 becomes 000010000 in binary.
+	 * TAGSET(4) becomes 000010000 in binary.
 	 *
 	 * The ^ is a binary exclusive or (XOR) operator which copies the bit if it is set in one
 	 * operand but not both.
@@ -6044,7 +8274,7 @@ toggletag(const Arg *arg)
 	 *
 	 * Meaning that the tags mask for the client now only holds tag 1 and 6.
 	 *
-	 * The arg->ui & TAGMASK is a safeguard that restricts the argument value to only hold as
+	 * The intersection with the tagmask is a safeguard that restricts the argument value to only hold as
 	 * many bits as there are tags.
 	 *
 	 * As an example let's say that the user were to change the tags array to only hold four
@@ -6056,21 +8286,28 @@ toggletag(const Arg *arg)
 	 * client from the current view.
 	 *
 	 * In this scenario the newtags variable would still have a value as the ninth bit is set
-	 * to 1, which means that we would enter the if (newtags) { statement and set the client's
+	 * to 1, which means that we would enter the if statement below and set the client's
 	 * tags to the new bitmask. The problem with this is that the client window would now be
 	 * out of view and it would not be possible to bring that client window into view again.
 	 *
 	 * By capping the input argument to only allow bits for as many tags there are avoids
 	 * problems like this.
 	 *
-	 * The TAGMASK macro is defined as:
-	 *    #define TAGMASK                 ((1 << LENGTH(tags)) - 1)
+	 * The tagmask variable holds all the tags that are defined, refer to the setup function.
+	 *
+	 * The tag set operations work on Tagsets rather than plain bitmasks as there may be more
+	 * tags than fit in an unsigned int, refer to the Tagset type.
 	 */
-	newtags = selmon->sel->tags ^ (arg->ui & TAGMASK);
+	if (arg->v)
+		tagsand(&newtags, arg->v, &tagmask);
+	tagsxor(&newtags, &selmon->sel->tags, &newtags);
 	/* If the client is shown on at least one tag then allow the new tagset to be set. */
-	if (newtags) {
+	if (!tagsempty(&newtags)) {
 		/* This sets the new tag mask for the selected client */
+		counttags(selmon->sel, -1);
 		selmon->sel->tags = newtags;
+		counttags(selmon->sel, 1);
+		selmon->visvalid = 0;
 		/* It is possible that the client window disappeared from the current view in which
 		 * case we should give focus to the next client in line. We also apply a full arrange
 		 * in order to resize and reposition clients to fill the gap the client left behind.
@@ -6089,9 +8326,10 @@ toggletag(const Arg *arg)
  *
  * @called_from keypress in relation to keybindings
  * @called_from buttonpress in relation to button bindings
+ * @calls pertagview to restore the layout state of the viewed tag(s)
  * @calls focus as the selected client may have been on a tag that was toggled away
  * @calls arrange as the client windows shown may have changed
- * @see TAGMASK macro
+ * @see tagmask variable
  *
  * Internal call stack:
  *    run -> keypress -> toggleview
@@ -6100,18 +8338,26 @@ toggletag(const Arg *arg)
 void
 toggleview(const Arg *arg)
 {
+	Tagset newtagset = { { 0 } };
+
 	/* This creates a new tagmask based on the selected monitor's selected tagset toggling
 	 * the tagmask given as an argument. Refer to the writeup in the toggletag function should
 	 * you need more information on how this works. */
-	unsigned int newtagset = selmon->tagset[selmon->seltags] ^ (arg->ui & TAGMASK);
+	if (arg->v)
+		tagsand(&newtagset, arg->v, &tagmask);
+	tagsxor(&newtagset, &selmon->tagset[selmon->seltags], &newtagset);
 	/* This prevents the scenario of toggling away the last viewed tag. I.e. there must be at
 	 * least one tag viewed. */
-	if (newtagset) {
+	if (!tagsempty(&newtagset)) {
 		/* This sets the new tag set for the selected monitor */
 		selmon->tagset[selmon->seltags] = newtagset;
+		selmon->visvalid = 0;
+		/* Restore the layout state of the tag(s) being viewed. */
+		pertagview(selmon);
 		/* The client that had focus may have been on a tag that was toggled away, so give
-		 * input focus to the next client in the stack. */
-		focus(NULL);
+		 * input focus to the client that last had focus on the tag(s) or to the next client
+		 * in the stack. */
+		focus(selmon->pertag[selmon->curtag].sel);
 		/* A full arrange as the constellation of client windows viewed may have changed. */
 		arrange(selmon);
 	}
@@ -6127,7 +8373,6 @@ toggleview(const Arg *arg)
  *
  * @called_from buttonpress when focus changes between monitors
  * @called_from enternotify when focus changes between monitors
- * @called_from motionnotify when focus changes between monitors
  * @called_from focusmon when focus changes between monitors
  * @called_from sendmon when focus changes between monitors
  * @called_from focus to unfocus the previously focused client
@@ -6165,7 +8410,6 @@ unfocus(Client *c, int setfocus)
 
 /* This function controls what happens when the window manager stops managing a window.
  *
- * @called_from cleanup to unmanage all client windows before exiting dwm
  * @called_from destroynotify to stop managing the window and remove the client
  * @called_from unmapnotify to stop managing the window and remove the client
  * @calls XGrabServer https://tronche.com/gui/x/xlib/window-and-session-manager/XGrabServer.html
@@ -6177,7 +8421,7 @@ unfocus(Client *c, int setfocus)
  * @calls detach to remove the client from the tile stack
  * @calls detachstack to remove the client from the stacking order
  * @calls setclientstate to set the client state to withdrawn state
- * @calls free to release memory used by the client struct
+ * @calls poolfree to release memory used by the client struct
  * @calls updateclientlist to remove the window from the _NET_CLIENT_LIST property
  *
  * Internal call stack:
@@ -6188,10 +8432,17 @@ unmanage(Client *c, int destroyed)
 {
 	Monitor *m = c->mon;
 	XWindowChanges wc;
+	unsigned int i;
 
+	TRACEBEGIN("unmanage");
 	/* Remove the given client from both the client list and the stack order list. */
 	detach(c);
+	windel(c->win);
 	detachstack(c);
+	/* Make sure that no tag remembers the client as the client that last had focus. */
+	for (i = 0; i <= LENGTH(tags); i++)
+		if (m->pertag[i].sel == c)
+			m->pertag[i].sel = NULL;
 	/* If the window has already been destroyed then we don't have to take any further action
 	 * with regards to the window itself. The function parameter destroyed will be true (1) if
 	 * unmanage is called from the destroynotify function.
@@ -6199,11 +8450,11 @@ unmanage(Client *c, int destroyed)
 	if (!destroyed) {
 		/* In principle this is intended to set the client's border width back to what it was
 		 * before dwm started managing it. This can be deduced by that in the manage function
-		 * we set c->oldbw to the border width of the original window attributes. There is no
-		 * guarantee, however, that the c->oldbw will still hold this value as the
+		 * we set c->cold->oldbw to the border width of the original window attributes. There is no
+		 * guarantee, however, that the c->cold->oldbw will still hold this value as the
 		 * setfullscreen function relies on the same variable to store the client's border
 		 * width before going into fullscreen. */
-		wc.border_width = c->oldbw;
+		wc.border_width = c->cold->oldbw;
 		/* This disables processing of requests and close downs on all other connections than
 		 * the one this request arrived on. */
 		XGrabServer(dpy); /* avoid race conditions */
@@ -6223,22 +8474,97 @@ unmanage(Client *c, int destroyed)
 		setclientstate(c, WithdrawnState);
 		/* This flushes the output buffer and then waits until all requests have been
 		 * received and processed by the X server. */
+		TRACEBEGIN("XSync");
 		XSync(dpy, False);
+		TRACEEND();
 		/* Revert to the normal X error handler */
 		XSetErrorHandler(xerror);
 		/* This restarts processing of requests and close downs on other connections */
 		XUngrabServer(dpy);
 	}
 	/* Free memory consumed by the client structure */
-	free(c);
-	/* Focus on the next client in the stacking order */
-	focus(NULL);
+	poolfree(&coldpool, c->cold);
+	poolfree(&clientpool, c);
+	/* Focus on the next client in the stacking order. If the client was the selected client
+	 * then detachstack has already found the next visible client in the stack, and otherwise
+	 * the selected client remains, so there is no need for focus to search the stack again. */
+	focus(selmon->sel);
 	/* As we have one less window being managed by the window manager we should update the
 	 * _NET_CLIENT_LIST property of the root window. */
 	updateclientlist();
 	/* Finally an arrange call to allow the remaining tiled clients to take advantage of the
 	 * space the unmanaged window left behind. */
 	arrange(m);
+	TRACEEND();
+}
+
+/* This stops managing all clients in one go when dwm exits.
+ *
+ * Calling unmanage for each client would grab the server, wait for the X server to process the
+ * requests, update the _NET_CLIENT_LIST property and arrange the monitor for every single client,
+ * which makes exiting with hundreds of windows noticeably slow. As no client remains to be
+ * focused or arranged afterwards all of that can be skipped. Instead the requests for all clients
+ * are sent in one batch while the server is grabbed, and we wait for the X server only once.
+ *
+ * Clients that are not shown are moved back to where they would be if their tags were viewed.
+ * This is because dwm hides client windows by moving them to a negative x position, and if the
+ * X session is taken over by another window manager then such windows would be in an unreachable
+ * location.
+ *
+ * @called_from cleanup to stop managing all windows before exiting
+ * @calls XGrabServer https://tronche.com/gui/x/xlib/window-and-session-manager/XGrabServer.html
+ * @calls XSetErrorHandler https://tronche.com/gui/x/xlib/event-handling/protocol-errors/XSetErrorHandler.html
+ * @calls XSelectInput https://tronche.com/gui/x/xlib/event-handling/XSelectInput.html
+ * @calls XConfigureWindow https://tronche.com/gui/x/xlib/window/XConfigureWindow.html
+ * @calls XUngrabButton https://tronche.com/gui/x/xlib/input/XUngrabButton.html
+ * @calls XSync https://tronche.com/gui/x/xlib/event-handling/XSync.html
+ * @calls XUngrabServer https://tronche.com/gui/x/xlib/window-and-session-manager/XUngrabServer.html
+ * @calls setclientstate to set the client state to withdrawn
+ * @calls poolfree to release memory used by the client structures
+ * @calls updateclientlist to clear the _NET_CLIENT_LIST property
+ *
+ * Internal call stack:
+ *    main -> cleanup -> unmanageall
+ */
+void
+unmanageall(void)
+{
+	Monitor *m;
+	Client *c, *next;
+	XWindowChanges wc;
+
+	XGrabServer(dpy); /* avoid race conditions */
+	XSetErrorHandler(xerrordummy);
+	for (m = mons; m; m = m->next)
+		for (c = m->clients; c; c = c->next) {
+			/* Refer to the unmanage function for what each of these requests do. */
+			wc.x = c->x;
+			wc.y = c->y;
+			wc.border_width = c->cold->oldbw;
+			XSelectInput(dpy, c->win, NoEventMask);
+			XConfigureWindow(dpy, c->win, CWX|CWY|CWBorderWidth, &wc);
+			XUngrabButton(dpy, AnyButton, AnyModifier, c->win);
+			setclientstate(c, WithdrawnState);
+		}
+	/* Wait once for the X server to have processed the requests for all clients. */
+	TRACEBEGIN("XSync");
+	XSync(dpy, False);
+	TRACEEND();
+	XSetErrorHandler(xerror);
+	XUngrabServer(dpy);
+
+	/* Free the client structures. There is no need to take each client out of the lists one
+	 * by one as the lists are simply emptied afterwards. */
+	for (m = mons; m; m = m->next) {
+		for (c = m->clients; c; c = next) {
+			next = c->next;
+			poolfree(&coldpool, c->cold);
+			poolfree(&clientpool, c);
+		}
+		m->clients = m->stack = m->sel = NULL;
+	}
+	/* With no clients left this removes the _NET_CLIENT_LIST property of the root window. */
+	updateclientlist();
 }
 
 /* This handles UnmapNotify events coming from the X server.
@@ -6293,13 +8619,25 @@ unmapnotify(XEvent *e)
 	}
 }
 
-/* This is what creates the bar window for each monitor.
+/* This is what creates the bar window and the desktop window for each monitor.
+ *
+ * The desktop window is an input only window, meaning that it is invisible, that covers the whole
+ * monitor and that is kept below all other windows. Its only purpose is to receive EnterNotify
+ * events when the mouse cursor moves from one monitor to the empty part (the root window) of
+ * another monitor, which lets the enternotify function change the selected monitor. The bar
+ * window receives EnterNotify events for the same reason.
+ *
+ * The alternative would be to subscribe to MotionNotify events for the root window and to check
+ * what monitor the mouse cursor is on for every single mouse movement, which would wake dwm up
+ * many times a second whenever the mouse is moved over an empty part of the screen.
  *
  * @called_from setup to initialise the bars
- * @called_from configurenotify in the event that the monitors or screen changes
+ * @called_from geomtimeout in the event that the monitors or screen changes
  * @calls XCreateWindow https://tronche.com/gui/x/xlib/window/XCreateWindow.html
  * @calls XDefineCursor https://tronche.com/gui/x/xlib/window/XDefineCursor.html
  * @calls XMapRaised https://tronche.com/gui/x/xlib/window/XMapRaised.html
+ * @calls XMapWindow https://tronche.com/gui/x/xlib/window/XMapWindow.html
+ * @calls XLowerWindow https://tronche.com/gui/x/xlib/window/XLowerWindow.html
  * @calls XSetClassHint https://tronche.com/gui/x/xlib/ICC/client-to-window-manager/XSetClassHint.html
  * @calls DefaultDepth https://linux.die.net/man/3/defaultdepth
  * @calls DefaultVisual https://linux.die.net/man/3/defaultvisual
@@ -6308,7 +8646,7 @@ unmapnotify(XEvent *e)
  *
  * Internal call stack:
  *    main -> setup -> updatebars
- *    run -> configurenotify -> updatebars
+ *    main -> run -> geomtimeout -> updatebars
  */
 void
 updatebars(void)
@@ -6321,14 +8659,29 @@ updatebars(void)
 		.override_redirect = True,
 		/* This makes it so that the background pixmap of the window's parent is used. */
 		.background_pixmap = ParentRelative,
-		/* This tells the X server that we are interested in receiving ButtonPress and Expose
-		 * events in relation to this window. */
-		.event_mask = ButtonPressMask|ExposureMask
+		/* This tells the X server that we are interested in receiving ButtonPress, Expose
+		 * and EnterNotify events in relation to this window. */
+		.event_mask = ButtonPressMask|ExposureMask|EnterWindowMask
+	};
+	/* The window attributes for the desktop window. We are only interested in receiving
+	 * EnterNotify events for this window. */
+	XSetWindowAttributes dwa = {
+		.override_redirect = True,
+		.event_mask = EnterWindowMask
 	};
 	/* The class hint for the bar window. This is set later with the XSetClassHint call. */
 	XClassHint ch = {"dwm", "dwm"};
 	/* Here we loop through each monitor */
 	for (m = mons; m; m = m->next) {
+		/* Create the desktop window if the monitor does not already have one. This is
+		 * lowered so that it is placed below all other windows. */
+		if (!m->deskwin) {
+			m->deskwin = XCreateWindow(dpy, root, m->mx, m->my, m->mw, m->mh, 0, 0,
+					InputOnly, CopyFromParent, CWOverrideRedirect|CWEventMask, &dwa);
+			XMapWindow(dpy, m->deskwin);
+			XLowerWindow(dpy, m->deskwin);
+			winadd(m->deskwin, NULL, m);
+		}
 		/* and if the monitor already have a bar window then we skip to the next. */
 		if (m->barwin)
 			continue;
@@ -6354,6 +8707,7 @@ updatebars(void)
 		 * This allows for compositors as an example to make exceptions for the bar.
 		 */
 		XSetClassHint(dpy, m->barwin, &ch);
+		winadd(m->barwin, NULL, m);
 	}
 }
 
@@ -6363,7 +8717,7 @@ updatebars(void)
  * @called_from updategeom to set the bar position and the monitor's window area for new monitors
  *
  * Internal call stack:
- *    run -> configurenotify -> updategeom -> updatebarpos
+ *    main -> run -> geomtimeout -> updategeom -> updatebarpos
  *    main -> setup -> updategeom -> updatebarpos
  */
 void
@@ -6406,6 +8760,7 @@ updatebarpos(Monitor *m)
  *    _NET_CLIENT_LIST(WINDOW): window id # 0x4e00002, 0x7000002, 0x6e00001, 0x6200002
  *
  * @called_from unmanage to remove unmanaged windows from _NET_CLIENT_LIST
+ * @called_from unmanageall to clear _NET_CLIENT_LIST before exiting
  * @calls XDeleteProperty https://tronche.com/gui/x/xlib/window-information/XDeleteProperty.html
  * @calls XChangeProperty https://tronche.com/gui/x/xlib/window-information/XChangeProperty.html
  * @see manage for how it updates _NET_CLIENT_LIST for new managed windows
@@ -6413,7 +8768,7 @@ updatebarpos(Monitor *m)
  *
  * Internal call stack:
  *    run -> destroynotify / unmapnotify -> unmanage -> updateclientlist
- *    main -> cleanup -> unmanage -> updateclientlist
+ *    main -> cleanup -> unmanageall -> updateclientlist
  */
 void
 updateclientlist(void)
@@ -6433,12 +8788,16 @@ updateclientlist(void)
 				(unsigned char *) &(c->win), 1);
 }
 
-/* This sets up monitors if the window manager is compiled with the Xinerama library. If dwm is
- * compiled without the Xinerama library, or in the event that Xinerama is not active for the
- * screen, then the available screen space is set up as a single workspace that spans all monitors.
+/* This sets up monitors if the window manager is compiled with the RandR or Xinerama library.
+ * RandR 1.5 monitors are preferred if the X server supports them as these can be updated
+ * incrementally. If dwm is compiled without either library, or in the event that neither is
+ * active for the screen, then the available screen space is set up as a single workspace that
+ * spans all monitors.
  *
  * @called_from setup to set up monitor(s) on startup
- * @called_from configurenotify if monitor(s) or screen change during runtime
+ * @called_from geomtimeout if monitor(s) or screen change during runtime
+ * @calls XRRGetMonitors and XRRFreeMonitors https://linux.die.net/man/3/xrandr
+ * @calls movetomon to move clients away from and back to RandR monitors
  * @calls XineramaIsActive https://linux.die.net/man/3/xineramaisactive
  * @calls XineramaQueryScreens https://linux.die.net/man/3/xineramaqueryscreens
  * @calls XFree https://tronche.com/gui/x/xlib/display/XFree.html
@@ -6453,9 +8812,10 @@ updateclientlist(void)
  * @calls cleanupmon in the event that we have less monitors
  * @calls free to release resources after parsing Xinerama screens
  * @calls wintomon to find the monitor the mouse cursor resides on
+ * @calls updaterefresh to look up the refresh rate of each monitor (if compiled with RandR)
  *
  * Internal call stack:
- *    run -> configurenotify -> updategeom
+ *    main -> run -> geomtimeout -> updategeom
  *    main -> setup -> updategeom
  */
 int
@@ -6463,6 +8823,108 @@ updategeom(void)
 {
 	int dirty = 0;
 
+	/* The span covers all the requests below that wait for a reply from the X server, including
+	 * XineramaIsActive which can not be wrapped on its own. */
+	TRACEBEGIN("updategeom");
+#ifdef XRANDR
+	/* With RandR 1.5 each monitor has a name, typically that of the output, which allows for
+	 * monitors to be updated incrementally. Monitors that are already known have their geometry
+	 * updated only if it has changed, new monitors are added and monitors that have gone away
+	 * are removed. Clients on a monitor that goes away are moved to the primary monitor, but
+	 * they remember the monitor they were on and are moved back when it comes back, e.g. when
+	 * docking a laptop again. */
+	if (haverandr) {
+		int i, j, n, isnew;
+		Client *c, *cnext;
+		Monitor *m, *mnext, *o, *tail, *target = NULL;
+		XRRMonitorInfo *info;
+
+		TRACEBEGIN("XRRGetMonitors");
+		info = XRRGetMonitors(dpy, root, True, &n);
+		TRACEEND();
+
+		/* Monitors that have the same geometry as one that came before, e.g. outputs that
+		 * mirror each other, are ignored by clearing their name. */
+		for (i = 0; i < n; i++)
+			for (j = 0; j < i && info[i].name; j++)
+				if (info[j].name
+				&& info[j].x == info[i].x && info[j].y == info[i].y
+				&& info[j].width == info[i].width && info[j].height == info[i].height)
+					info[i].name = None;
+
+		/* Find the monitor for each RandR monitor, creating it after the last monitor if it
+		 * is new, and update its geometry if it has changed. */
+		for (tail = nmons ? montab[nmons - 1] : NULL, i = 0; i < n; i++) {
+			if (!info[i].name)
+				continue;
+			for (m = mons; m && m->rrname != info[i].name; m = m->next);
+			if ((isnew = !m)) {
+				m = createmon();
+				m->rrname = info[i].name;
+				if (tail)
+					tail->next = m;
+				else
+					mons = m;
+				tail = m;
+			}
+			if (info[i].primary || !target)
+				target = m;
+			if (!isnew && info[i].x == m->mx && info[i].y == m->my
+			&& info[i].width == m->mw && info[i].height == m->mh)
+				continue;
+			dirty = 1;
+			m->mx = m->wx = info[i].x;
+			m->my = m->wy = info[i].y;
+			m->mw = m->ww = info[i].width;
+			m->mh = m->wh = info[i].height;
+			updatebarpos(m);
+			if (!isnew)
+				continue;
+			/* Bring back the clients that were on this monitor when it went away. */
+			for (o = mons; o; o = o->next)
+				for (c = o->clients; c && o != m; c = cnext) {
+					cnext = c->next;
+					if (c->cold->rrhome == m->rrname) {
+						c->cold->rrhome = None;
+						movetomon(c, m);
+					}
+				}
+		}
+
+		/* Remove the monitors that have gone away, moving their clients to the primary
+		 * monitor. Clients that already remember a monitor keep remembering that one. If
+		 * there are no active monitors at all (no target) then we keep things as they are
+		 * rather than removing all monitors. */
+		for (m = mons; m && target; m = mnext) {
+			mnext = m->next;
+			for (i = 0; i < n && (!m->rrname || info[i].name != m->rrname); i++);
+			if (i < n)
+				continue;
+			dirty = 1;
+			while ((c = m->clients)) {
+				if (!c->cold->rrhome)
+					c->cold->rrhome = m->rrname;
+				movetomon(c, target);
+			}
+			if (m == selmon)
+				selmon = target;
+			cleanupmon(m);
+		}
+		XRRFreeMonitors(info);
+
+		/* If there are no active monitors at all when dwm starts, e.g. when all outputs are
+		 * turned off, then we set up a single monitor spanning the screen as in the default
+		 * monitor setup below, as dwm needs at least one monitor. This monitor has no name,
+		 * so it is removed as above once RandR reports an active monitor. */
+		if (!mons) {
+			dirty = 1;
+			mons = createmon();
+			mons->mw = mons->ww = sw;
+			mons->mh = mons->wh = sh;
+			updatebarpos(mons);
+		}
+	} else
+#endif /* XRANDR */
 #ifdef XINERAMA
 	/* This checks if Xinerama is active on the screen (we would expect this to be true). */
 	if (XineramaIsActive(dpy)) {
@@ -6473,11 +8935,15 @@ updategeom(void)
 		 * within the Xinerama Screen. The variable nn here refers to the number of entries
 		 * the info list. This list can in principle contain duplicate geometries so we are
 		 * going to de-duplicate it by checking for unique geometries. */
-		XineramaScreenInfo *info = XineramaQueryScreens(dpy, &nn);
+		XineramaScreenInfo *info;
 		XineramaScreenInfo *unique = NULL;
 
-		/* This loops through all monitors in order to find the current monitor count (n). */
-		for (n = 0, m = mons; m; m = m->next, n++);
+		TRACEBEGIN("XineramaQueryScreens");
+		info = XineramaQueryScreens(dpy, &nn);
+		TRACEEND();
+
+		/* The current monitor count (n), refer to the updatemontab function. */
+		n = nmons;
 		/* Only consider unique geometries as separate screens. Here we allocate space to
 		 * hold up to nn unique XineramaScreenInfo entries. */
 		unique = ecalloc(nn, sizeof(XineramaScreenInfo));
@@ -6495,16 +8961,15 @@ updategeom(void)
 		/* New monitors if nn > n. If this is the first time this function is run (via setup)
 		 * then the number of exiting monitors (n) will be 0, but otherwise we would only
 		 * process this for-loop if we have new monitors to add. */
-		for (i = n; i < nn; i++) {
-			/* This sets m to the last monitor. */
-			for (m = mons; m && m->next; m = m->next);
-			/* If we have a last monitor then just create a new monitor after that. */
+		for (i = n, m = n ? montab[n - 1] : NULL; i < nn; i++) {
+			/* If we have a last monitor (m) then just create a new monitor after that,
+			 * which then becomes the last monitor. */
 			if (m)
-				m->next = createmon();
+				m = m->next = createmon();
 			/* Otherwise this is the first monitor being created, so we set mons which
 			 * refers to the first monitor in the (linked) list of monitors. */
 			else
-				mons = createmon();
+				m = mons = createmon();
 		}
 		/* Now we need to loop through each monitor and update the monitor coordinates as
 		 * well as the size of each monitor. */
@@ -6533,9 +8998,10 @@ updategeom(void)
 		 * setup) then we will not enter this for loop. In the event that a monitor has been
 		 * removed then we need to move all the clients on that monitor to one that is still
 		 * visible. For simplicity clients are moved to the first (often primary) monitor. */
-		for (i = nn; i < n; i++) {
-			/* This finds the last monitor (m). */
-			for (m = mons; m && m->next; m = m->next);
+		for (i = n - 1; i >= nn; i--) {
+			/* This finds the last monitor (m). The montab array still holds the monitors
+			 * as they were when this function was called. */
+			m = montab[i];
 			/* Then we repeat the below for all clients on monitor m, setting c to the
 			 * first client in the list. */
 			while ((c = m->clients)) {
@@ -6582,6 +9048,8 @@ updategeom(void)
 			updatebarpos(mons);
 		}
 	}
+	/* Rebuild the monitor array and the grid used to look up monitors by position. */
+	updatemontab();
 	/* If we have made any change in terms of monitors, position or sizes then the dirty flag
 	 * will have been set. In this case we revert the selected monitor back to the first
 	 * monitor, then we try to set the selected monitor based on the location of the mouse
@@ -6592,11 +9060,85 @@ updategeom(void)
 		selmon = mons;
 		selmon = wintomon(root);
 	}
+#ifdef XRANDR
+	/* The refresh rates may have changed even if the monitor geometries did not. */
+	updaterefresh();
+#endif /* XRANDR */
+	TRACEEND();
 	/* Return the dirty flag to indicate whether this call to updategeom resulted in any change
-	 * to monitor setup. This return value is used in the configurenotify function. */
+	 * to monitor setup. This return value is used in the geomtimeout function. */
 	return dirty;
 }
 
+/* This rebuilds the array of monitors and the grid used to look up what monitor a point is on.
+ *
+ * The montab array holds the monitors in the same order as the linked list of monitors, and the
+ * num variable of each monitor is set to its index in the array. This allows for monitors to be
+ * looked up by number, e.g. by dirtomon and applyrules, without going through the list.
+ *
+ * For the grid, the area covered by all monitors is divided into GRIDSIZE by GRIDSIZE cells and
+ * for each cell we note the monitors that overlap it. Looking up what monitor a point is on then
+ * only involves working out what cell the point is in and checking the monitors that overlap that
+ * cell, refer to the recttomon function. Unless the point is near the edge of a monitor there is
+ * only one such monitor, regardless of how many monitors there are.
+ *
+ * The grid is based on the monitor area rather than the window area as the window area changes
+ * when the bar is shown or hidden, while the monitor area only changes when this is called.
+ *
+ * @called_from updategeom after the monitors have been set up
+ * @calls ecalloc to allocate memory for the array and the grid
+ *
+ * Internal call stack:
+ *    main -> setup -> updategeom -> updatemontab
+ *    main -> run -> geomtimeout -> updategeom -> updatemontab
+ */
+void
+updatemontab(void)
+{
+	unsigned int cell, next[GRIDSIZE * GRIDSIZE];
+	int i, x, y, x0, y0, x1, y1;
+	Monitor *m;
+
+	for (nmons = 0, m = mons; m; m = m->next, nmons++);
+	free(montab);
+	montab = ecalloc(nmons, sizeof(Monitor *));
+	x0 = y0 = INT_MAX;
+	x1 = y1 = INT_MIN;
+	for (i = 0, m = mons; m; m = m->next, i++) {
+		montab[i] = m;
+		m->num = i;
+		x0 = MIN(x0, m->mx);
+		y0 = MIN(y0, m->my);
+		x1 = MAX(x1, m->mx + m->mw);
+		y1 = MAX(y1, m->my + m->mh);
+	}
+
+	/* The size of the grid cells, rounded up so that the grid covers all monitors. */
+	gridx = x0;
+	gridy = y0;
+	gridw = MAX(1, (x1 - x0 + GRIDSIZE - 1) / GRIDSIZE);
+	gridh = MAX(1, (y1 - y0 + GRIDSIZE - 1) / GRIDSIZE);
+
+	/* First count the monitors that overlap each cell, so that gridstart[i + 1] holds the count
+	 * for cell i, then add these up so that gridstart[i] holds the index in gridmons where the
+	 * monitors for cell i start. Finally the monitors are filled in, in the order of the list. */
+	memset(gridstart, 0, sizeof gridstart);
+	for (m = mons; m; m = m->next)
+		for (y = (m->my - gridy) / gridh; y <= (m->my + m->mh - 1 - gridy) / gridh; y++)
+			for (x = (m->mx - gridx) / gridw; x <= (m->mx + m->mw - 1 - gridx) / gridw; x++)
+				gridstart[y * GRIDSIZE + x + 1]++;
+	for (cell = 0; cell < GRIDSIZE * GRIDSIZE; cell++) {
+		gridstart[cell + 1] += gridstart[cell];
+		next[cell] = gridstart[cell];
+	}
+	free(gridmons);
+	gridmons = ecalloc(MAX(gridstart[GRIDSIZE * GRIDSIZE], 1), sizeof(Monitor *));
+	for (m = mons; m; m = m->next)
+		for (y = (m->my - gridy) / gridh; y <= (m->my + m->mh - 1 - gridy) / gridh; y++)
+			for (x = (m->mx - gridx) / gridw; x <= (m->mx + m->mw - 1 - gridx) / gridw; x++)
+				gridmons[next[y * GRIDSIZE + x]++] = m;
+}
+
 /* This function sets or updates the internal Num Lock mask variable.
  *
  * As per the tronche documentation we have that:
@@ -6613,7 +9155,10 @@ updategeom(void)
  * Once this is found the modifier is stored in the global and static numlockmask variable. This
  * is later used in the context of handling key and button presses.
  *
- * @called_from grabbuttons to make sure the numlock modifier is correct before grabbing buttons
+ * Retrieving the modifier mapping involves a round trip to the X server, so this is only done
+ * on startup and when the keyboard or modifier mapping changes. If the Num Lock modifier has
+ * changed then the grabgen variable is incremented so that button grabs are redone.
+ *
  * @called_from grabkeys to make sure the numlock modifier is correct before grabbing keys
  * @calls XGetModifierMapping https://tronche.com/gui/x/xlib/input/XGetModifierMapping.html
  * @calls XKeysymToKeycode https://tronche.com/gui/x/xlib/utilities/keyboard/XKeysymToKeycode.html
@@ -6622,15 +9167,13 @@ updategeom(void)
  * @see https://tronche.com/gui/x/xlib/input/keyboard-encoding.html#XModifierKeymap
  *
  * Internal call stack:
- *    ~ -> focus / unfocus -> grabbuttons -> updatenumlockmask
- *    run -> maprequest -> manage -> grabbuttons -> updatenumlockmask
  *    run -> mappingnotify -> grabkeys -> updatenumlockmask
  *    main -> setup -> grabkeys -> updatenumlockmask
  */
 void
 updatenumlockmask(void)
 {
-	unsigned int i, j;
+	unsigned int i, j, prev = numlockmask;
 	XModifierKeymap *modmap;
 
 	/* Clear the num lock mask variable to cover for the edge case where the modifier is
@@ -6638,7 +9181,9 @@ updatenumlockmask(void)
 	numlockmask = 0;
 	/* This retrieves a new modifier mapping structure that contains the keys being used as
 	 * modifiers. */
+	TRACEBEGIN("XGetModifierMapping");
 	modmap = XGetModifierMapping(dpy);
+	TRACEEND();
 	/* We loop through each modifier */
 	for (i = 0; i < 8; i++)
 		/* and we loop through each key per modifier */
@@ -6651,7 +9196,73 @@ updatenumlockmask(void)
 	/* The caller of XGetModifierMapping is responsible for freeing the memory used by the
 	 * returned modifier key map. */
 	XFreeModifiermap(modmap);
+	/* Let the grabbuttons function know that existing button grabs are out of date */
+	if (numlockmask != prev)
+		grabgen++;
+}
+
+#ifdef XRANDR
+/* This updates the refresh rate of each monitor using the RandR extension.
+ *
+ * Each CRTC (a display controller, which drives one or more outputs) has a mode which determines
+ * the resolution and the refresh rate. The refresh rate is the pixel clock divided by the total
+ * number of pixels per frame, including the blanking intervals. The CRTC is matched with the
+ * monitor based on the position.
+ *
+ * Monitors that do not match a CRTC (e.g. when Xinerama screens do not line up with the CRTCs)
+ * keep the default refresh rate as set in the configuration file.
+ *
+ * @called_from updategeom to update the refresh rates following monitor changes
+ * @calls XRRGetScreenResourcesCurrent https://linux.die.net/man/3/xrandr
+ * @calls XRRGetCrtcInfo https://linux.die.net/man/3/xrandr
+ * @calls XRRFreeCrtcInfo https://linux.die.net/man/3/xrandr
+ * @calls XRRFreeScreenResources https://linux.die.net/man/3/xrandr
+ *
+ * Internal call stack:
+ *    main -> run -> geomtimeout -> updategeom -> updaterefresh
+ *    main -> setup -> updategeom -> updaterefresh
+ */
+void
+updaterefresh(void)
+{
+	int i, j;
+	unsigned int rate;
+	Monitor *m;
+	XRRScreenResources *sr;
+	XRRCrtcInfo *ci;
+	XRRModeInfo *mi;
+
+	for (m = mons; m; m = m->next)
+		m->refresh = refreshrate;
+	TRACEBEGIN("updaterefresh");
+	if (!(sr = XRRGetScreenResourcesCurrent(dpy, root))) {
+		TRACEEND();
+		return;
+	}
+	for (i = 0; i < sr->ncrtc; i++) {
+		if (!(ci = XRRGetCrtcInfo(dpy, sr, sr->crtcs[i])))
+			continue;
+		for (j = 0, mi = NULL; ci->mode && j < sr->nmode; j++)
+			if (sr->modes[j].id == ci->mode)
+				mi = &sr->modes[j];
+		if (mi && mi->hTotal && mi->vTotal) {
+			rate = (double)mi->dotClock / ((double)mi->hTotal * mi->vTotal) + 0.5;
+			/* Interlaced modes show twice as many (half) frames, double scan modes show
+			 * every line twice. */
+			if (mi->modeFlags & RR_Interlace)
+				rate *= 2;
+			if (mi->modeFlags & RR_DoubleScan)
+				rate /= 2;
+			for (m = mons; m; m = m->next)
+				if (m->mx == ci->x && m->my == ci->y && rate)
+					m->refresh = rate;
+		}
+		XRRFreeCrtcInfo(ci);
+	}
+	XRRFreeScreenResources(sr);
+	TRACEEND();
 }
+#endif /* XRANDR */
 
 /* This updates the size hints for a client window.
  *
@@ -6681,6 +9292,8 @@ updatesizehints(Client *c)
 	long msize;
 	XSizeHints size;
 
+	TRACEBEGIN("updatesizehints");
+
 	/* If we fail to read the normal window management hints then we set size.flags to PSize
 	 * so that it has a value and that we go through all of the remaining if statements below
 	 * to set the default values. */
@@ -6749,7 +9362,44 @@ updatesizehints(Client *c)
 	/* One may think of hintsvalid as a flag that indicates whether size hints need to be
 	 * updated or not. Here we set that to 1 to indicate that size hints are now up to date. */
 	c->hintsvalid = 1;
+	TRACEEND();
+}
+
+#ifdef STATS
+/* This sets the _DWM_STATS property of the root window to hold the statistics in the Prometheus
+ * text format, refer to the statswrite function.
+ *
+ * This is done on request rather than periodically as there is no point in updating the property
+ * if nobody reads it. A program asks for the statistics by sending a ClientMessage event with the
+ * _DWM_STATS message type to the root window (using SubstructureRedirectMask as the event mask),
+ * and then reads the property once it changes, e.g.
+ *
+ *    $ xprop -root -notype _DWM_STATS
+ *
+ * @called_from clientmessage when a program asks for the statistics
+ * @calls open_memstream https://man7.org/linux/man-pages/man3/open_memstream.3.html
+ * @calls statswrite to write the statistics
+ * @calls XChangeProperty https://tronche.com/gui/x/xlib/window-information/XChangeProperty.html
+ *
+ * Internal call stack:
+ *    run -> clientmessage -> updatestats
+ */
+void
+updatestats(void)
+{
+	char *buf = NULL;
+	size_t len = 0;
+	FILE *f;
+
+	if (!(f = open_memstream(&buf, &len)))
+		return;
+	statswrite(f);
+	if (!fclose(f))
+		XChangeProperty(dpy, root, statsatom, XA_STRING, 8, PropModeReplace,
+			(unsigned char *)buf, len);
+	free(buf);
 }
+#endif /* STATS */
 
 /* This updates the status text by reading the WM_NAME property of the root window.
  *
@@ -6758,24 +9408,89 @@ updatesizehints(Client *c)
  *
  * @called_from setup to initialise stext and trigger the initial drawing of the bar
  * @called_from propertynotify whenever the WM_NAME property of the root window changes
+ * @called_from statustimeout to redraw the status that changed while throttled
  * @calls gettextprop to read the WM_NAME text property of the root name
  * @calls strcpy to set the default status text to "dwm-6.3"
  * @calls drawbar to update the bar as the status text has changed
+ * @calls settimer to limit how often the status is redrawn
  * @see https://dwm.suckless.org/status_monitor/
  *
  * Internal call stack:
  *    run -> setup -> updatestatus
  *    run -> propertynotify -> updatestatus
+ *    run -> statustimeout -> updatestatus
  */
 void
 updatestatus(void)
 {
+	/* If the status was updated recently then we only note that it has changed and leave it to
+	 * statustimeout to redraw the bar once the throttle timer expires. This avoids that status
+	 * monitors that update many times per second cause dwm to spend all its time drawing. */
+	if (statusbusy) {
+		statuspending = 1;
+		return;
+	}
+
 	/* This retrieves the text property of WM_NAME from the root window and stores that in the
 	 * status text (stext) variable which is later used when drawing the bar. */
 	if (!gettextprop(root, XA_WM_NAME, stext, sizeof(stext)))
 		strcpy(stext, "dwm-"VERSION);
 	/* Update the bar as the status text has changed */
 	drawbar(selmon);
+
+	/* Start the throttle timer, refer to the statusthrottle setting in config.def.h. */
+	if (statusthrottle) {
+		statusbusy = 1;
+		settimer(statustimer, statusthrottle);
+	}
+}
+
+/* This checks whether a client supports the _NET_WM_SYNC_REQUEST protocol, in which case the
+ * XSync counter of the client is stored in the synccounter variable.
+ *
+ * A client supports the protocol if it lists _NET_WM_SYNC_REQUEST in the WM_PROTOCOLS property
+ * and has set the _NET_WM_SYNC_REQUEST_COUNTER property.
+ *
+ *    $ xprop | grep -e WM_PROTOCOLS -e SYNC
+ *    WM_PROTOCOLS(ATOM): protocols  WM_DELETE_WINDOW, WM_TAKE_FOCUS, _NET_WM_SYNC_REQUEST
+ *    _NET_WM_SYNC_REQUEST_COUNTER(CARDINAL) = 16777226
+ *
+ * @called_from manage to check new clients
+ * @called_from propertynotify when the WM_PROTOCOLS or _NET_WM_SYNC_REQUEST_COUNTER properties
+ *              change
+ * @calls XGetWMProtocols https://tronche.com/gui/x/xlib/ICC/client-to-window-manager/XGetWMProtocols.html
+ * @calls XGetWindowProperty https://tronche.com/gui/x/xlib/window-information/XGetWindowProperty.html
+ * @calls XFree https://tronche.com/gui/x/xlib/display/XFree.html
+ *
+ * Internal call stack:
+ *    run -> maprequest -> manage -> updatesynccounter
+ *    run -> propertynotify -> updatesynccounter
+ */
+void
+updatesynccounter(Client *c)
+{
+	int n, di, supported = 0;
+	unsigned long nitems, dl;
+	unsigned char *p = NULL;
+	Atom *protocols, da;
+
+	c->cold->synccounter = None;
+	if (!havesync)
+		return;
+
+	TRACEBEGIN("updatesynccounter");
+	if (XGetWMProtocols(dpy, c->win, &protocols, &n)) {
+		while (!supported && n--)
+			supported = protocols[n] == netatom[NetWMSyncRequest];
+		XFree(protocols);
+	}
+	if (supported && XGetWindowProperty(dpy, c->win, netatom[NetWMSyncRequestCounter], 0L, 1L,
+		False, XA_CARDINAL, &da, &di, &nitems, &dl, &p) == Success && p) {
+		if (nitems)
+			c->cold->synccounter = *(long *)p;
+		XFree(p);
+	}
+	TRACEEND();
 }
 
 /* This updates the window title for the client.
@@ -6808,10 +9523,10 @@ updatetitle(Client *c)
 	 *
 	 *    xdotool selectwindow set_window --name "new title"
 	 */
-	if (!gettextprop(c->win, netatom[NetWMName], c->name, sizeof c->name))
+	if (!gettextprop(c->win, netatom[NetWMName], c->cold->name, sizeof c->cold->name))
 		/* Fall back to checking WM_NAME if the window does not have a _NET_WM_NAME
 		 * property. */
-		gettextprop(c->win, XA_WM_NAME, c->name, sizeof c->name);
+		gettextprop(c->win, XA_WM_NAME, c->cold->name, sizeof c->cold->name);
 	/* Some windows do not have a window title set, in which case we fall back to using the
 	 * text "broken" to indicate this. It is better than displaying nothing in the window
 	 * title.
@@ -6822,8 +9537,51 @@ updatetitle(Client *c)
 	 * The strcpy call copies all bytes (characters) from the broken array into the client
 	 * name variable.
 	 */
-	if (c->name[0] == '\0') /* hack to mark broken clients */
-		strcpy(c->name, broken);
+	if (c->cold->name[0] == '\0') /* hack to mark broken clients */
+		strcpy(c->cold->name, broken);
+}
+
+/* This rebuilds the arrays of visible clients and visible tiled clients for a monitor.
+ *
+ * The arrays hold the clients in the order of the client list and are used by the layouts and
+ * by focusstack so that these do not have to go through the clients on other tags, which may be
+ * many. Rather than rebuilding the arrays every time something changes, the visvalid flag of the
+ * monitor is cleared and the arrays are rebuilt the next time that they are needed. This is much
+ * the same as how size hints are handled, refer to the updatesizehints function.
+ *
+ * The arrays are grown as needed, but never shrink.
+ *
+ * @called_from focusstack, monocle and tile when the arrays are out of date
+ * @calls ecalloc to allocate memory for the arrays
+ *
+ * Internal call stack:
+ *    ~ -> arrange -> arrangemon -> tile / monocle -> updatevisible
+ *    run -> keypress -> focusstack -> updatevisible
+ */
+void
+updatevisible(Monitor *m)
+{
+	int n;
+	Client *c;
+
+	for (n = 0, c = m->clients; c; c = c->next, n++);
+	if (n > m->viscap) {
+		m->viscap = MAX(n, 2 * m->viscap);
+		free(m->vis);
+		free(m->tiled);
+		m->vis = ecalloc(m->viscap, sizeof(Client *));
+		m->tiled = ecalloc(m->viscap, sizeof(Client *));
+	}
+
+	m->nvis = m->ntiled = 0;
+	for (c = m->clients; c; c = c->next) {
+		if (!ISVISIBLE(c))
+			continue;
+		m->vis[m->nvis++] = c;
+		if (!c->isfloating)
+			m->tiled[m->ntiled++] = c;
+	}
+	m->visvalid = 1;
 }
 
 /* This reads window properties to update the window type.
@@ -6862,8 +9620,10 @@ updatewindowtype(Client *c)
 	if (state == netatom[NetWMFullscreen])
 		setfullscreen(c, 1);
 	/* If the window type suggests a dialog box then we make that window floating. */
-	if (wtype == netatom[NetWMWindowTypeDialog])
+	if (wtype == netatom[NetWMWindowTypeDialog]) {
 		c->isfloating = 1;
+		c->mon->visvalid = 0;
+	}
 }
 
 /* This reads window management hints for a given client window.
@@ -6885,6 +9645,8 @@ updatewmhints(Client *c)
 {
 	XWMHints *wmh;
 
+	TRACEBEGIN("updatewmhints");
+
 	/* This call reads the window management hints for the client's window. */
 	if ((wmh = XGetWMHints(dpy, c->win))) {
 		/* If the hints could be read then check if the urgency hint is present. If it is and
@@ -6914,6 +9676,7 @@ updatewmhints(Client *c)
 		/* NB: there are other hint flags in the structure but most of these are related to
 		 * the window icon and the rest are simply unused by dwm. */
 	}
+	TRACEEND();
 }
 
 /* The view function changes the view to a given bitmask.
@@ -6925,40 +9688,173 @@ updatewmhints(Client *c)
  *
  * @called_from keypress in relation to keybindings
  * @called_from buttonpress in relation to button bindings
- * @called_from cleanup to bring all client windows into view before exiting
+ * @calls pertagview to restore the layout state of the viewed tag
  * @calls focus to give input focus to the last viewed client on the viewed tag
  * @calls arrange as the client windows shown may have changed
- * @see TAGMASK macro
+ * @see tagmask variable
  *
  * Internal call stack:
  *    run -> keypress -> view
  *    run -> buttonpress -> view
- *    main -> cleanup -> view
  */
 void
 view(const Arg *arg)
 {
-	/* If the given bitmask is the same as what is currently shown then do nothing. This makes
+	Tagset newtagset = { { 0 } };
+
+	/* If the given tag set is the same as what is currently shown then do nothing. This makes
 	 * it so that if you are on tag 7 and you hit MOD+7 then nothing happens. */
-	if ((arg->ui & TAGMASK) == selmon->tagset[selmon->seltags])
+	if (arg->v)
+		tagsand(&newtagset, arg->v, &tagmask);
+	if (tagsequal(&newtagset, &selmon->tagset[selmon->seltags]))
 		return;
 	/* This toggles between the previous and current tagset. */
 	selmon->seltags ^= 1; /* toggle sel tagset */
-	/* This sets the new tagset, unless the given unsigned int argument is 0. This has
-	 * specifically to do with the MOD+Tab keybinding that passes 0 as the bitmask to toggle
-	 * between the current and previous tagset.
+	/* This sets the new tagset, unless the given tag set is empty. This has specifically to
+	 * do with the MOD+Tab keybinding that passes no tag set to toggle between the current and
+	 * previous tagset.
 	 *
 	 *    { MODKEY,                       XK_Tab,    view,           {0} },
 	 */
-	if (arg->ui & TAGMASK)
-		selmon->tagset[selmon->seltags] = arg->ui & TAGMASK;
-	/* Focus on the first visible client in the stack as the view has changed */
-	focus(NULL);
+	if (!tagsempty(&newtagset))
+		selmon->tagset[selmon->seltags] = newtagset;
+	selmon->visvalid = 0;
+	/* Restore the layout state of the tag being viewed. */
+	pertagview(selmon);
+	/* Focus on the client that last had focus on the tag, or the first visible client in the
+	 * stack as the view has changed */
+	focus(selmon->pertag[selmon->curtag].sel);
 	/* Finally a full arrange call to hide clients that are not shown and to bring into view
 	 * the clients that are, to tile them and to update the bar. */
 	arrange(selmon);
 }
 
+/* This adds a window to the window table, refer to the winslot function.
+ *
+ * The table is kept at most half full so that looking up windows stays fast, which means that
+ * it is grown by rebuilding it at twice the size when needed.
+ *
+ * @called_from manage to add a client window
+ * @called_from updatebars to add the bar and desktop windows of a monitor
+ * @calls ecalloc to allocate memory for the table
+ * @calls winhash to find the slot for each window when rebuilding the table
+ *
+ * Internal call stack:
+ *    run -> maprequest -> manage -> winadd
+ *    ~ -> updatebars -> winadd
+ */
+void
+winadd(Window w, Client *c, Monitor *m)
+{
+	WinSlot *old = wintab;
+	unsigned int i, h, oldsize = wintabsize;
+
+	if (2 * (nwins + 1) > wintabsize) {
+		wintabsize = MAX(64, 2 * wintabsize);
+		wintab = ecalloc(wintabsize, sizeof(WinSlot));
+		for (i = 0; i < oldsize; i++) {
+			if (!old[i].win)
+				continue;
+			for (h = winhash(old[i].win); wintab[h].win; h = (h + 1) & (wintabsize - 1));
+			wintab[h] = old[i];
+		}
+		free(old);
+	}
+	for (h = winhash(w); wintab[h].win && wintab[h].win != w; h = (h + 1) & (wintabsize - 1));
+	if (!wintab[h].win)
+		nwins++;
+	wintab[h].win = w;
+	wintab[h].client = c;
+	wintab[h].mon = m;
+}
+
+/* This removes a window from the window table, refer to the winslot function.
+ *
+ * With linear probing we can not simply empty the slot of the window as that could cut short the
+ * search for windows that were placed after it due to collisions. Instead the windows that follow
+ * are moved back to fill the gap, unless they are already in their home slot or between their home
+ * slot and the gap.
+ *
+ * @called_from cleanupmon to remove the bar and desktop windows of a monitor
+ * @called_from unmanage to remove a client window
+ * @calls winslot to find the slot of the window
+ * @calls winhash to find the home slot of the windows that follow
+ *
+ * Internal call stack:
+ *    run -> destroynotify / unmapnotify -> unmanage -> windel
+ *    ~ -> cleanupmon -> windel
+ */
+void
+windel(Window w)
+{
+	WinSlot *s;
+	unsigned int i, j, h;
+
+	if (!(s = winslot(w)))
+		return;
+	nwins--;
+	for (i = j = s - wintab;;) {
+		wintab[i].win = None;
+		for (;;) {
+			j = (j + 1) & (wintabsize - 1);
+			if (!wintab[j].win)
+				return;
+			h = winhash(wintab[j].win);
+			/* The window in slot j can fill the gap in slot i unless its home slot h lies
+			 * cyclically in (i, j]. */
+			if (i <= j ? (i < h && h <= j) : (i < h || h <= j))
+				continue;
+			break;
+		}
+		wintab[i] = wintab[j];
+		i = j;
+	}
+}
+
+/* This returns the slot in the window table where the search for a given window starts.
+ *
+ * Window IDs handed out by the X server to a client share the same high bits, so the ID is mixed
+ * using multiplicative hashing much like the keyhash function does for key codes.
+ *
+ * @called_from winadd, windel and winslot
+ */
+unsigned int
+winhash(Window w)
+{
+	return ((unsigned int)w * 2654435761u >> 8) & (wintabsize - 1);
+}
+
+/* This looks up a window in the window table, returning the slot for the window or NULL if the
+ * window is not known to dwm.
+ *
+ * The window table maps client windows to their clients, and the bar and desktop windows of each
+ * monitor to their monitor. It is an open addressing hash table using linear probing, which means
+ * that if the slot for a window is taken then the window goes into the next free slot. This allows
+ * wintoclient and wintomon, which are called for most events, to find the client or monitor for a
+ * window without going through all clients on all monitors.
+ *
+ * @called_from wintoclient to find the client for a window
+ * @called_from wintomon to find the monitor for a window
+ * @called_from windel to find the window being removed
+ * @calls winhash to find where to start looking
+ *
+ * Internal call stack:
+ *    ~ -> wintoclient -> winslot
+ *    ~ -> wintomon -> winslot
+ */
+WinSlot *
+winslot(Window w)
+{
+	unsigned int h;
+
+	if (!wintabsize || !w)
+		return NULL;
+	for (h = winhash(w); wintab[h].win; h = (h + 1) & (wintabsize - 1))
+		if (wintab[h].win == w)
+			return &wintab[h];
+	return NULL;
+}
+
 /* Internal function to search for a client that is associated with a given window.
  *
  * This is called from most event handling functions to translate window IDs to client references.
@@ -6972,32 +9868,22 @@ view(const Arg *arg)
  * @called_from maprequest to sanity check that the window is not already managed by the WM
  * @called_from propertynotify to find the client the property notification is for
  * @called_from unmapnotify to find the client the unmap notification is for
- * @called_from wintomon to find the monitor the given window is on (via the client)
  *
  * Internal call stack:
  *    run -> maprequest -> manage -> wintoclient
- *    run -> buttonpress / enternotify / expose -> wintomon -> wintoclient
  *    run -> buttonpress / clientmessage / configurerequest / maprequest -> wintoclient
  *    run -> destroynotify / enternotify / propertynotify / unmapnotify -> wintoclient
- *    run -> configurenotify -> updategeom -> wintomon -> wintoclient
- *    main -> setup -> updategeom -> wintomon -> wintoclient
  */
 Client *
 wintoclient(Window w)
 {
-	Client *c;
-	Monitor *m;
+	WinSlot *s = winslot(w);
 
-	/* Loop through all monitors */
-	for (m = mons; m; m = m->next)
-		/* Loop through all clients for each monitor */
-		for (c = m->clients; c; c = c->next)
-			/* If we find the client associated with the given window then return it */
-			if (c->win == w)
-				return c;
-	/* Return NULL to indicate that we did not find a client related to the given window. This
-	 * means that the window is not managed by the window manager. */
-	return NULL;
+	/* Look up the window in the window table, refer to the winslot function. Note that the bar
+	 * and desktop windows are also in the table, but these do not have a client. Return NULL
+	 * to indicate that we did not find a client related to the given window. This means that
+	 * the window is not managed by the window manager. */
+	return s ? s->client : NULL;
 }
 
 /* Internal function to find the monitor a given window is on.
@@ -7008,34 +9894,29 @@ wintoclient(Window w)
  * @called_from updategeom to find the monitor the mouse cursor resides on
  * @calls getrooptr to find the mouse pointer coordinates if window is the root window
  * @calls recttomon to find the monitor the mouse pointer is on
- * @calls wintoclient to find the client related to the given window
+ * @calls winslot to find the client or monitor related to the given window
  *
  * Internal call stack:
  *    run -> buttonpress / enternotify / expose -> wintomon
- *    run -> configurenotify -> updategeom -> wintomon
+ *    main -> run -> geomtimeout -> updategeom -> wintomon
  *    main -> setup -> updategeom -> wintomon
  */
 Monitor *
 wintomon(Window w)
 {
 	int x, y;
-	Client *c;
-	Monitor *m;
+	WinSlot *s;
 
 	/* If the given window is the root window then retrieve the mouse coordinates and pass
 	 * these on to recttomon to work out what monitor the mouse pointer is on. */
 	if (w == root && getrootptr(&x, &y))
 		return recttomon(x, y, 1, 1);
-	/* Loop through all monitors */
-	for (m = mons; m; m = m->next)
-		/* Check if the given window is the bar window, if so then we know what monitor that
-		 * window resides on. */
-		if (w == m->barwin)
-			return m;
-	/* Check if the given window is one of the managed clients, and if so then return the
-	 * monitor that client is assigned to. */
-	if ((c = wintoclient(w)))
-		return c->mon;
+	/* Look up the window in the window table, refer to the winslot function. If the given
+	 * window is the bar window or the desktop window of a monitor then we know what monitor
+	 * that window resides on, and if it is one of the managed clients then return the monitor
+	 * that client is assigned to. */
+	if ((s = winslot(w)))
+		return s->client ? s->client->mon : s->mon;
 	/* If we come here then we are at a loss; the given window is not known to us and it is
 	 * not managed by the window manager. Fall back to just returning the currently selected
 	 * monitor.
@@ -7057,7 +9938,9 @@ xerror(Display *dpy, XErrorEvent *ee)
 	|| (ee->request_code == X_ConfigureWindow && ee->error_code == BadMatch)
 	|| (ee->request_code == X_GrabButton && ee->error_code == BadAccess)
 	|| (ee->request_code == X_GrabKey && ee->error_code == BadAccess)
-	|| (ee->request_code == X_CopyArea && ee->error_code == BadDrawable))
+	|| (ee->request_code == X_CopyArea && ee->error_code == BadDrawable)
+	|| (havesync && ee->error_code == syncerrbase + XSyncBadCounter)
+	|| (havesync && ee->error_code == syncerrbase + XSyncBadAlarm))
 		return 0;
 	fprintf(stderr, "dwm: fatal error: request code=%d, error code=%d\n",
 		ee->request_code, ee->error_code);
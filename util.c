@@ -1,9 +1,12 @@
 /* See LICENSE file for copyright and license details. */
 #include <errno.h>
+#include <fcntl.h>
 #include <stdarg.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <time.h>
+#include <unistd.h>
 
 /* The util library comes from libsl which contains some functionality that is common for several
  * suckless project, e.g. dmenu and dwm.
@@ -13,6 +16,14 @@
 
 #include "util.h"
 
+#ifdef TRACE
+/* The trace file, the process ID that the trace events are recorded against, and whether any trace
+ * events have been written yet. Refer to the traceopen function. */
+int tracing = 0;
+static FILE *tracefp;
+static int tracepid, tracefirst;
+#endif /* TRACE */
+
 /* Helper function that prints an error before exiting the process.
  *
  * @called_from ecalloc in case of error
@@ -84,8 +95,7 @@ die(const char *fmt, ...)
  * @called_from drw_create to allocate memory for the drawable
  * @called_from setup to allocate memory for colour schemes
  * @called_from updategeom to allocate memory to hold unique screen info
- * @called_from createmon to allocate memory for new Monitor structures
- * @called_from manage to allocate memory for new Client structures
+ * @called_from poolalloc to allocate memory for a new slab
  * @calls calloc to allocate memory
  * @calls die in the event that memory could not be allocated
  *
@@ -99,8 +109,8 @@ die(const char *fmt, ...)
  *    main -> setup -> updategeom -> createmon -> ecalloc
  *    run -> configurenotify -> updategeom -> ecalloc
  *    run -> configurenotify -> updategeom -> createmon -> ecalloc
- *    run -> maprequest -> manage -> ecalloc
- *    run -> scan -> manage -> ecalloc
+ *    run -> maprequest -> manage -> poolalloc -> ecalloc
+ *    run -> scan -> manage -> poolalloc -> ecalloc
  */
 void *
 ecalloc(size_t nmemb, size_t size)
@@ -112,3 +122,215 @@ ecalloc(size_t nmemb, size_t size)
         die("calloc:");
     return p;
 }
+
+/* Objects in a pool, as well as the slabs that they are allocated from, are aligned to this many
+ * bytes which is enough for any of the types that they hold. */
+#define POOLALIGN 16
+
+/* Allocates a zeroed object from a pool.
+ *
+ * Rather than allocating each object on its own the pool allocates slabs of memory that hold
+ * several objects at a time, and objects that are freed are kept in a free list to be handed out
+ * again. Windows that come and go in quick succession thereby reuse the same memory instead of
+ * fragmenting the heap, and objects of the same kind end up close to each other in memory.
+ *
+ * Slabs are never returned to the system until the pool is destroyed, refer to pooldestroy.
+ *
+ * @called_from createmon to allocate memory for new Monitor structures
+ * @called_from manage to allocate memory for new Client structures
+ * @calls ecalloc to allocate memory for a new slab
+ * @calls memset to clear an object that is being reused
+ *
+ * Internal call stack:
+ *    main -> setup -> updategeom -> createmon -> poolalloc
+ *    run -> configurenotify -> updategeom -> createmon -> poolalloc
+ *    run -> maprequest -> manage -> poolalloc
+ *    run -> scan -> manage -> poolalloc
+ */
+void *
+poolalloc(Pool *p)
+{
+	size_t i, size = (p->size + POOLALIGN - 1) / POOLALIGN * POOLALIGN;
+	char *slab;
+	void *o;
+
+	if (!p->free) {
+		/* The first bytes of a slab refer to the previous slab so that all slabs can be
+		 * freed when the pool is destroyed, the objects follow. Every object in the new slab
+		 * is added to the free list, each referring to the next. */
+		slab = ecalloc(1, POOLALIGN + p->perslab * size);
+		*(void **)slab = p->slabs;
+		p->slabs = slab;
+		p->nslabs++;
+		for (i = p->perslab; i > 0; i--) {
+			o = slab + POOLALIGN + (i - 1) * size;
+			*(void **)o = p->free;
+			p->free = o;
+		}
+	}
+
+	/* Take the first object off the free list. */
+	o = p->free;
+	p->free = *(void **)o;
+	memset(o, 0, p->size);
+	if (++p->nused > p->maxused)
+		p->maxused = p->nused;
+	return o;
+}
+
+/* Returns the number of bytes allocated for the slabs of a pool. This includes the space that
+ * objects take up once rounded up to POOLALIGN, as well as the header at the start of each slab.
+ *
+ * @called_from cleanup to report the memory used by the pools
+ * @called_from statswrite to export the memory used by the pools
+ *
+ * Internal call stack:
+ *    main -> cleanup -> poolbytes
+ *    main -> run -> statstimeout -> statswrite -> poolbytes
+ */
+size_t
+poolbytes(const Pool *p)
+{
+	size_t size = (p->size + POOLALIGN - 1) / POOLALIGN * POOLALIGN;
+
+	return p->nslabs * (POOLALIGN + p->perslab * size);
+}
+
+/* Frees all the slabs of a pool, which must not be used afterwards.
+ *
+ * @called_from cleanup to free the client and monitor pools
+ * @calls free to free each slab
+ *
+ * Internal call stack:
+ *    main -> cleanup -> pooldestroy
+ */
+void
+pooldestroy(Pool *p)
+{
+	void *slab;
+
+	while ((slab = p->slabs)) {
+		p->slabs = *(void **)slab;
+		free(slab);
+	}
+	p->free = NULL;
+	p->nslabs = p->nused = 0;
+}
+
+/* Returns an object to the pool that it was allocated from, making it available for reuse.
+ *
+ * @called_from cleanupmon to free a Monitor structure
+ * @called_from unmanage to free a Client structure
+ *
+ * Internal call stack:
+ *    main -> cleanup -> cleanupmon -> poolfree
+ *    run -> configurenotify -> updategeom -> cleanupmon -> poolfree
+ *    run -> destroynotify / unmapnotify -> unmanage -> poolfree
+ */
+void
+poolfree(Pool *p, void *o)
+{
+	*(void **)o = p->free;
+	p->free = o;
+	p->nused--;
+}
+
+#ifdef TRACE
+/* Writes a trace event of the given phase with the current time of the monotonic clock. The
+ * timestamps of the Chrome trace event format are in microseconds, and fractions are allowed. */
+static void
+traceevent(const char *name, char phase)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	fprintf(tracefp, "%s{\"name\":\"%s\",\"ph\":\"%c\",\"ts\":%ld.%03ld,\"pid\":%d,\"tid\":%d}",
+		tracefirst ? "" : ",\n", name, phase, (long)ts.tv_sec * 1000000 + ts.tv_nsec / 1000,
+		ts.tv_nsec % 1000, tracepid, tracepid);
+	tracefirst = 0;
+}
+
+/* Marks the beginning of a span in the trace, use the TRACEBEGIN macro rather than calling this
+ * directly.
+ *
+ * @called_from the TRACEBEGIN macro if tracing is on
+ * @calls traceevent to write a begin event
+ */
+void
+tracebegin(const char *name)
+{
+	traceevent(name, 'B');
+}
+
+/* Stops tracing and finishes the trace file.
+ *
+ * @called_from sigevent when tracing is toggled off
+ * @called_from cleanup if tracing is on when dwm exits
+ * @calls fclose https://man7.org/linux/man-pages/man3/fclose.3.html
+ *
+ * Internal call stack:
+ *    main -> run -> sigevent -> traceclose
+ *    main -> cleanup -> traceclose
+ */
+void
+traceclose(void)
+{
+	fputs("\n]\n", tracefp);
+	fclose(tracefp);
+	tracefp = NULL;
+	tracing = 0;
+}
+
+/* Marks the end of the span that was begun last, use the TRACEEND macro rather than calling this
+ * directly.
+ *
+ * @called_from the TRACEEND macro if tracing is on
+ * @calls traceevent to write an end event
+ */
+void
+traceend(void)
+{
+	traceevent("", 'E');
+}
+
+/* Starts tracing to the given file. Returns 1 if the file could be opened, 0 otherwise.
+ *
+ * The trace records the beginning and the end of spans of time marked with the TRACEBEGIN and
+ * TRACEEND macros, e.g. the handling of each event, arranging and drawing, and requests that wait
+ * for a reply from the X server. The file is written in the JSON array form of the Chrome trace
+ * event format, which can be opened in Perfetto (https://ui.perfetto.dev) or chrome://tracing.
+ *
+ * Trace events are buffered by stdio, so the trace only costs a formatted write per event while
+ * tracing is on and a single branch per span while it is off.
+ *
+ * The file must not exist already and it is created readable by the user only. The trace may be
+ * written to a shared directory such as /tmp, where following a symbolic link or truncating a
+ * file planted by someone else would let them have dwm overwrite any file the user can write.
+ *
+ * @called_from sigevent when tracing is toggled on
+ * @calls open https://man7.org/linux/man-pages/man2/open.2.html
+ * @calls fdopen https://man7.org/linux/man-pages/man3/fdopen.3.html
+ * @see https://docs.google.com/document/d/1CvAClvFfyA5R-PhYUmn5OOQtYMH4h6I0nSsKchNAySU
+ *
+ * Internal call stack:
+ *    main -> run -> sigevent -> traceopen
+ */
+int
+traceopen(const char *path)
+{
+	int fd;
+
+	if ((fd = open(path, O_WRONLY|O_CREAT|O_EXCL|O_NOFOLLOW|O_CLOEXEC, 0600)) == -1
+	|| !(tracefp = fdopen(fd, "w"))) {
+		fprintf(stderr, "dwm: cannot open trace file %s\n", path);
+		if (fd != -1)
+			close(fd);
+		return 0;
+	}
+	tracepid = getpid();
+	tracefirst = 1;
+	tracing = 1;
+	fputs("[\n", tracefp);
+	return 1;
+}
+#endif /* TRACE */
@@ -12,6 +12,51 @@
 /* This calculates the number of items of an array. */
 #define LENGTH(X)               (sizeof X / sizeof X[0])
 
+/* A pool of objects of the same size, refer to the poolalloc function. A pool is initialised with
+ * the size of the objects and the number of objects to allocate at a time, e.g.
+ *
+ *    static Pool clientpool = { sizeof(Client), 64 };
+ *
+ * The remaining fields are maintained by the pool functions.
+ *    free    - the list of objects that are available for reuse
+ *    slabs   - the list of blocks of memory that objects are allocated from
+ *    nslabs  - the number of slabs allocated
+ *    nused   - the number of objects currently in use
+ *    maxused - the highest number of objects that have been in use at the same time
+ */
+typedef struct {
+	size_t size;
+	size_t perslab;
+	void *free;
+	void *slabs;
+	size_t nslabs, nused, maxused;
+} Pool;
+
+/* Macros that mark the beginning and the end of a span of time in the trace, refer to the
+ * traceopen function. The name must be a string that does not need escaping in JSON. Spans must be
+ * nested, i.e. TRACEEND ends the span that was begun last. The macros do nothing unless tracing is
+ * on, and they compile to nothing unless dwm is compiled with tracing (see config.mk). */
+#ifdef TRACE
+#define TRACEBEGIN(NAME)        do { if (tracing) tracebegin(NAME); } while (0)
+#define TRACEEND()              do { if (tracing) traceend(); } while (0)
+#else
+#define TRACEBEGIN(NAME)        do { } while (0)
+#define TRACEEND()              do { } while (0)
+#endif /* TRACE */
+
 /* Function declarations. */
 void die(const char *fmt, ...);
 void *ecalloc(size_t nmemb, size_t size);
+void *poolalloc(Pool *p);
+size_t poolbytes(const Pool *p);
+void pooldestroy(Pool *p);
+void poolfree(Pool *p, void *o);
+#ifdef TRACE
+void tracebegin(const char *name);
+void traceclose(void);
+void traceend(void);
+int traceopen(const char *path);
+
+/* Whether tracing is on, i.e. whether a trace file is open. */
+extern int tracing;
+#endif /* TRACE */